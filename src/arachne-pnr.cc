@@ -27,12 +27,15 @@
 #include "carry.hh"
 #include "constant.hh"
 #include "designstate.hh"
+#include "timing.hh"
+#include "eco.hh"
 #include "util.hh"
 
 #include <iostream>
 #include <fstream>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
 
 const char *program_name;
 
@@ -74,7 +77,8 @@ usage()
 #endif
     << "\n"
     << "    --write-binary-chipdb <file>\n"
-    << "        Write binary chipdb to <file>.\n"
+    << "        Write binary chipdb to <file>.  This also precomputes the\n"
+    << "        router's lookahead table for the device.\n"
     << "\n"
     << "    -l, --no-promote-globals\n"
     << "        Don't promote nets to globals.\n"
@@ -100,10 +104,134 @@ usage()
     << "    -r\n"
     << "        Randomize seed.\n"
     << "\n"
+    << "    --place-threads <int>\n"
+    << "        Run <int> placers with seeds derived from the seed on\n"
+    << "        separate threads and keep the placement with the lowest\n"
+    << "        wire length.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --place-region-threads <int>\n"
+    << "        Split the chip into <int> strips of columns and anneal the\n"
+    << "        logic cells in each strip on a separate thread.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --place-analytic\n"
+    << "        Start annealing from a quadratic placement of the logic\n"
+    << "        cells instead of the greedy initial placement.\n"
+    << "\n"
+    << "    --place-analytic-temp <float>\n"
+    << "        Starting annealing temperature with --place-analytic.\n"
+    << "        Default: 10\n"
+    << "\n"
+    << "    --place-effort fast|normal|high\n"
+    << "        Placement effort.  fast and high scale the annealing moves\n"
+    << "        per temperature with the size of the design.\n"
+    << "        Default: normal\n"
+    << "\n"
+    << "    --place-time <float>\n"
+    << "        Cool fast enough to finish annealing in about <float>\n"
+    << "        seconds, 0 for no limit.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --place-congestion-weight <float>\n"
+    << "        Weight of the estimated routing congestion (RUDY demand in\n"
+    << "        excess of the span wires in each tile) in the placement\n"
+    << "        cost, 0 to place for wire length only.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --place-detail\n"
+    << "        After annealing, greedily move each logic cell to the median\n"
+    << "        of its nets' bounding boxes and try swapping cells within\n"
+    << "        3x3-tile windows.\n"
+    << "\n"
+    << "    --place-eco <placement-file>\n"
+    << "        Incremental placement: start the instances that appear in\n"
+    << "        <placement-file> (matched by type and output nets) at\n"
+    << "        their previous cells, place the rest around them, and\n"
+    << "        anneal at a low temperature.\n"
+    << "\n"
+    << "    --place-eco-lock\n"
+    << "        With --place-eco, keep the matched instances at their\n"
+    << "        previous cells.\n"
+    << "\n"
+    << "    --place-eco-temp <float>\n"
+    << "        Starting annealing temperature with --place-eco.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --write-placement <placement-file>\n"
+    << "        Write the placement to <placement-file> for --place-eco.\n"
+    << "\n"
     << "    -m <int>, --max-passes <int>\n"
     << "        Maximum number of routing passes.\n"
     << "        Default: 200\n"
     << "\n"
+    << "    --astar-weight <float>\n"
+    << "        Weight of the A* lookahead used by the router.  1 keeps the\n"
+    << "        estimate admissible, larger values expand fewer routing\n"
+    << "        resources at some cost in route quality, 0 disables it.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --route-bbox-margin <int>\n"
+    << "        Restrict the search for each net to the bbox of its terminals\n"
+    << "        grown by <int> tiles.  The margin doubles for nets that fail\n"
+    << "        to route inside it.\n"
+    << "        Default: 3\n"
+    << "\n"
+    << "    --route-threads <int>\n"
+    << "        Route nets in disjoint regions of the chip with <int>\n"
+    << "        threads.  Nets that cross regions are routed serially.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --route-pres-fac <float>\n"
+    << "        Initial weight of present congestion in routing costs.\n"
+    << "        Default: 3\n"
+    << "\n"
+    << "    --route-pres-fac-mult <float>\n"
+    << "        Multiply the present congestion weight by <float> after\n"
+    << "        each routing pass.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --route-hist-fac <float>\n"
+    << "        Weight of historical congestion in routing costs.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --route-stall-passes <int>\n"
+    << "        Double the present congestion weight when the number of\n"
+    << "        shared routing resources hasn't improved for <int>\n"
+    << "        passes, 0 to disable.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --route-final-pass-penalty <int>\n"
+    << "        Cost of a routing resource already in use in the last\n"
+    << "        routing pass.\n"
+    << "        Default: 1000000\n"
+    << "\n"
+    << "    --route-eco <route-file>\n"
+    << "        Incremental routing: keep the routes in <route-file> of\n"
+    << "        nets whose terminals are unchanged, rerouting them only\n"
+    << "        if they conflict with other nets.\n"
+    << "\n"
+    << "    --write-routes <route-file>\n"
+    << "        Write the routes to <route-file> for --route-eco.\n"
+    << "\n"
+    << "    --timing\n"
+    << "        Run static timing analysis, weight critical nets in\n"
+    << "        placement and routing, and report the critical path of\n"
+    << "        each clock.\n"
+    << "\n"
+    << "    --delay-model <file>\n"
+    << "        Read cell and wire delays from <file>.  Implies --timing.\n"
+    << "\n"
+    << "    --timing-period <float>\n"
+    << "        Target clock period in ns for criticality, 0 to use each\n"
+    << "        clock's critical path.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --place-timing-weight <float>\n"
+    << "        Weight net wire length by 1 + <float> * criticality^2 in\n"
+    << "        placement with --timing.\n"
+    << "        Default: 4\n"
+    << "\n"
     << "    -s <int>, --seed <int>\n"
     << "        Set seed for random generator to <int>.\n"
     << "        Default: 1\n"
@@ -132,7 +260,11 @@ main(int argc, const char **argv)
     quiet = false,
     do_promote_globals = true,
     route_only = false,
-    randomize_seed = false;
+    randomize_seed = false,
+    place_analytic = false,
+    place_detail = false,
+    place_eco_lock = false,
+    timing = false;
   std::string device = "1k";
   const char *chipdb_file = nullptr,
     *input_file = nullptr,
@@ -145,6 +277,28 @@ main(int argc, const char **argv)
     *output_file = nullptr,
     *seed_str = nullptr,
     *max_passes_str = nullptr,
+    *astar_weight_str = nullptr,
+    *bbox_margin_str = nullptr,
+    *route_threads_str = nullptr,
+    *place_threads_str = nullptr,
+    *place_region_threads_str = nullptr,
+    *place_analytic_temp_str = nullptr,
+    *place_effort_str = nullptr,
+    *place_time_str = nullptr,
+    *place_congestion_weight_str = nullptr,
+    *place_eco = nullptr,
+    *place_eco_temp_str = nullptr,
+    *write_placement_file = nullptr,
+    *route_eco = nullptr,
+    *write_routes_file = nullptr,
+    *pres_fac_str = nullptr,
+    *pres_fac_mult_str = nullptr,
+    *hist_fac_str = nullptr,
+    *stall_passes_str = nullptr,
+    *final_pass_penalty_str = nullptr,
+    *delay_model_file = nullptr,
+    *timing_period_str = nullptr,
+    *place_timing_weight_str = nullptr,
     *binary_chipdb = nullptr;
   
   for (int i = 1; i < argc; ++i)
@@ -261,6 +415,191 @@ main(int argc, const char **argv)
               ++i;
               max_passes_str = argv[i];
             }
+          else if (!strcmp(argv[i], "--astar-weight"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              astar_weight_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-bbox-margin"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              bbox_margin_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-threads"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_threads_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-region-threads"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_region_threads_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-analytic"))
+            place_analytic = true;
+          else if (!strcmp(argv[i], "--place-detail"))
+            place_detail = true;
+          else if (!strcmp(argv[i], "--place-eco"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_eco = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-eco-lock"))
+            place_eco_lock = true;
+          else if (!strcmp(argv[i], "--place-eco-temp"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_eco_temp_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--write-placement"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              write_placement_file = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-analytic-temp"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_analytic_temp_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-effort"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_effort_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-time"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_time_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-congestion-weight"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_congestion_weight_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-threads"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              route_threads_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-pres-fac"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              pres_fac_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-pres-fac-mult"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              pres_fac_mult_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-hist-fac"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              hist_fac_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-stall-passes"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              stall_passes_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-final-pass-penalty"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              final_pass_penalty_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-eco"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              route_eco = argv[i];
+            }
+          else if (!strcmp(argv[i], "--write-routes"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              write_routes_file = argv[i];
+            }
+          else if (!strcmp(argv[i], "--timing"))
+            timing = true;
+          else if (!strcmp(argv[i], "--delay-model"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              delay_model_file = argv[i];
+              timing = true;
+            }
+          else if (!strcmp(argv[i], "--timing-period"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              timing_period_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--place-timing-weight"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+              
+              ++i;
+              place_timing_weight_str = argv[i];
+            }
           else if (!strcmp(argv[i], "-o")
                    || !strcmp(argv[i], "--output-file"))
             {
@@ -359,6 +698,266 @@ main(int argc, const char **argv)
   else
     max_passes = 200;
   
+  double astar_weight = 1.0;
+  if (astar_weight_str)
+    {
+      char *end;
+      astar_weight = strtod(astar_weight_str, &end);
+      if (end == astar_weight_str
+          || *end != '\0'
+          || !(astar_weight >= 0.0))
+        fatal(fmt("invalid astar-weight value `" << astar_weight_str << "'"));
+    }
+  
+  int bbox_margin = 0;
+  if (bbox_margin_str)
+    {
+      std::string bbox_margin_s = bbox_margin_str;
+      
+      if (bbox_margin_s.empty())
+        fatal("invalid empty route-bbox-margin value");
+      
+      for (char ch : bbox_margin_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            bbox_margin = bbox_margin * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in route-bbox-margin value"));
+        }
+    }
+  else
+    bbox_margin = 3;
+  
+  int route_threads = 0;
+  if (route_threads_str)
+    {
+      std::string route_threads_s = route_threads_str;
+      
+      if (route_threads_s.empty())
+        fatal("invalid empty route-threads value");
+      
+      for (char ch : route_threads_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            route_threads = route_threads * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in route-threads value"));
+        }
+      if (route_threads == 0)
+        fatal("route-threads value must be positive");
+    }
+  else
+    route_threads = 1;
+  
+  PlaceOptions place_opts;
+  if (place_threads_str)
+    {
+      std::string place_threads_s = place_threads_str;
+      
+      if (place_threads_s.empty())
+        fatal("invalid empty place-threads value");
+      
+      int place_threads = 0;
+      for (char ch : place_threads_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            place_threads = place_threads * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in place-threads value"));
+        }
+      if (place_threads == 0)
+        fatal("place-threads value must be positive");
+      place_opts.n_threads = place_threads;
+    }
+  if (place_region_threads_str)
+    {
+      std::string place_region_threads_s = place_region_threads_str;
+      
+      if (place_region_threads_s.empty())
+        fatal("invalid empty place-region-threads value");
+      
+      int place_region_threads = 0;
+      for (char ch : place_region_threads_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            place_region_threads = place_region_threads * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in place-region-threads value"));
+        }
+      if (place_region_threads == 0)
+        fatal("place-region-threads value must be positive");
+      place_opts.n_region_threads = place_region_threads;
+    }
+  place_opts.analytic = place_analytic;
+  place_opts.detail = place_detail;
+  if (place_analytic_temp_str)
+    {
+      char *end;
+      place_opts.analytic_temp = strtod(place_analytic_temp_str, &end);
+      if (end == place_analytic_temp_str
+          || *end != '\0'
+          || !(place_opts.analytic_temp > 0.0))
+        fatal(fmt("invalid place-analytic-temp value `" << place_analytic_temp_str << "'"));
+    }
+  if (place_effort_str)
+    {
+      if (!strcmp(place_effort_str, "fast"))
+        place_opts.effort = PlaceEffort::FAST;
+      else if (!strcmp(place_effort_str, "normal"))
+        place_opts.effort = PlaceEffort::NORMAL;
+      else if (!strcmp(place_effort_str, "high"))
+        place_opts.effort = PlaceEffort::HIGH;
+      else
+        fatal(fmt("invalid place-effort value `" << place_effort_str << "'"));
+    }
+  if (place_time_str)
+    {
+      char *end;
+      place_opts.time_budget = strtod(place_time_str, &end);
+      if (end == place_time_str
+          || *end != '\0'
+          || !(place_opts.time_budget >= 0.0))
+        fatal(fmt("invalid place-time value `" << place_time_str << "'"));
+    }
+  if (place_congestion_weight_str)
+    {
+      char *end;
+      place_opts.congestion_weight = strtod(place_congestion_weight_str, &end);
+      if (end == place_congestion_weight_str
+          || *end != '\0'
+          || !(place_opts.congestion_weight >= 0.0))
+        fatal(fmt("invalid place-congestion-weight value `" << place_congestion_weight_str << "'"));
+    }
+  place_opts.eco_lock = place_eco_lock;
+  if (place_eco_temp_str)
+    {
+      char *end;
+      place_opts.eco_temp = strtod(place_eco_temp_str, &end);
+      if (end == place_eco_temp_str
+          || *end != '\0'
+          || !(place_opts.eco_temp > 0.0))
+        fatal(fmt("invalid place-eco-temp value `" << place_eco_temp_str << "'"));
+    }
+  if (place_timing_weight_str)
+    {
+      char *end;
+      place_opts.timing_weight = strtod(place_timing_weight_str, &end);
+      if (end == place_timing_weight_str
+          || *end != '\0'
+          || !(place_opts.timing_weight >= 0.0))
+        fatal(fmt("invalid place-timing-weight value `" << place_timing_weight_str << "'"));
+    }
+  
+  double timing_period = 0.0;
+  if (timing_period_str)
+    {
+      char *end;
+      timing_period = strtod(timing_period_str, &end);
+      if (end == timing_period_str
+          || *end != '\0'
+          || !(timing_period >= 0.0))
+        fatal(fmt("invalid timing-period value `" << timing_period_str << "'"));
+      timing_period *= 1000.0;  // ps
+    }
+  
+  RouteOptions route_opts;
+  route_opts.max_passes = max_passes;
+  route_opts.astar_weight = astar_weight;
+  route_opts.bbox_margin = bbox_margin;
+  route_opts.n_threads = route_threads;
+  
+  if (pres_fac_str)
+    {
+      char *end;
+      route_opts.pres_fac = strtod(pres_fac_str, &end);
+      if (end == pres_fac_str
+          || *end != '\0'
+          || !(route_opts.pres_fac >= 0.0))
+        fatal(fmt("invalid route-pres-fac value `" << pres_fac_str << "'"));
+    }
+  
+  if (pres_fac_mult_str)
+    {
+      char *end;
+      route_opts.pres_fac_mult = strtod(pres_fac_mult_str, &end);
+      if (end == pres_fac_mult_str
+          || *end != '\0'
+          || !(route_opts.pres_fac_mult >= 1.0))
+        fatal(fmt("invalid route-pres-fac-mult value `" << pres_fac_mult_str << "'"));
+    }
+  
+  if (hist_fac_str)
+    {
+      char *end;
+      route_opts.hist_fac = strtod(hist_fac_str, &end);
+      if (end == hist_fac_str
+          || *end != '\0'
+          || !(route_opts.hist_fac >= 0.0))
+        fatal(fmt("invalid route-hist-fac value `" << hist_fac_str << "'"));
+    }
+  
+  if (stall_passes_str)
+    {
+      std::string stall_passes_s = stall_passes_str;
+      
+      if (stall_passes_s.empty())
+        fatal("invalid empty route-stall-passes value");
+      
+      int stall_passes = 0;
+      for (char ch : stall_passes_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            stall_passes = stall_passes * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in route-stall-passes value"));
+        }
+      route_opts.stall_passes = stall_passes;
+    }
+  
+  if (final_pass_penalty_str)
+    {
+      // path costs are sums of cnet costs in an int
+      const int max_final_pass_penalty = 100000000;
+      
+      std::string final_pass_penalty_s = final_pass_penalty_str;
+      
+      if (final_pass_penalty_s.empty())
+        fatal("invalid empty route-final-pass-penalty value");
+      
+      int final_pass_penalty = 0;
+      for (char ch : final_pass_penalty_s)
+        {
+          if (ch >= '0'
+              && ch <= '9')
+            final_pass_penalty = final_pass_penalty * 10 + (unsigned)(ch - '0');
+          else
+            fatal(fmt("invalid character `" 
+                      << ch
+                      << "' in unsigned integer literal in route-final-pass-penalty value"));
+          if (final_pass_penalty > max_final_pass_penalty)
+            fatal(fmt("route-final-pass-penalty value `" << final_pass_penalty_s
+                      << "' too large, at most " << max_final_pass_penalty));
+        }
+      if (final_pass_penalty < 1)
+        fatal("invalid route-final-pass-penalty value 0");
+      route_opts.final_pass_penalty = final_pass_penalty;
+    }
+  
   if (randomize_seed)
     {
       std::random_device rd;
@@ -388,10 +987,23 @@ main(int argc, const char **argv)
                      + ".bin");
 #endif
   *logs << "read_chipdb " << chipdb_file_s << "...\n";
-  const ChipDB *chipdb = read_chipdb(chipdb_file_s);
+  ChipDB *chipdb = read_chipdb(chipdb_file_s);
+  
+  DelayModel dm;
+  if (delay_model_file)
+    {
+      *logs << "read_delay_model " << delay_model_file << "...\n";
+      dm = read_delay_model(delay_model_file, chipdb->device);
+    }
   
   if (binary_chipdb)
     {
+      if (chipdb->lookahead.empty())
+        {
+          *logs << "compute_lookahead...\n";
+          chipdb->compute_lookahead();
+        }
+      
       *logs << "write_binary_chipdb " << binary_chipdb << "\n";
       
       std::string expanded = expand_filename(binary_chipdb);
@@ -543,14 +1155,49 @@ main(int argc, const char **argv)
         d->check();
 #endif
 	
+        std::map<Instance *, int, IdLess> eco_placement;
+        if (place_eco)
+          {
+            *logs << "read_placement " << place_eco << "...\n";
+            eco_placement = read_placement(place_eco, ds);
+            place_opts.eco_placement = &eco_placement;
+          }
+        
+        std::unique_ptr<TimingGraph> place_timing;
+        if (timing)
+          {
+            place_timing.reset(new TimingGraph(ds, dm, timing_period));
+            place_opts.timing = place_timing.get();
+          }
+        
         *logs << "place...\n";
         // d->dump();
-        place(rg, ds);
+        place(rg, ds, place_opts);
 #ifndef NDEBUG
         d->check();
 #endif
         // d->dump();
         
+        if (timing)
+          {
+            place_timing->estimate_wire_delays(place_timing->placement_cells(ds.placement));
+            place_timing->analyze();
+            *logs << "\nAfter placement timing estimate:\n";
+            place_timing->report(*logs);
+          }
+        
+        if (write_placement_file)
+          {
+            *logs << "write_placement " << write_placement_file << "...\n";
+            std::string expanded = expand_filename(write_placement_file);
+            std::ofstream fs(expanded);
+            if (fs.fail())
+              fatal(fmt("write_placement: failed to open `" << expanded << "': "
+                        << strerror(errno)));
+            fs << "# " << version_str << "\n";
+            write_placement(fs, ds);
+          }
+        
         if (post_place_pcf)
           {
             *logs << "write_pcf " << post_place_pcf << "...\n";
@@ -604,12 +1251,47 @@ main(int argc, const char **argv)
     
     // d->dump();
     
+    NetRoutes eco_routes, routes;
+    if (route_eco)
+      {
+        *logs << "read_routes " << route_eco << "...\n";
+        eco_routes = read_routes(route_eco, chipdb);
+        route_opts.eco_routes = &eco_routes;
+      }
+    if (write_routes_file)
+      route_opts.routes_out = &routes;
+    
+    std::unique_ptr<TimingGraph> route_timing;
+    if (timing)
+      {
+        route_timing.reset(new TimingGraph(ds, dm, timing_period));
+        route_opts.timing = route_timing.get();
+      }
+    
     *logs << "route...\n";
-    route(ds, max_passes);
+    route(ds, route_opts);
 #ifndef NDEBUG
     d->check();
 #endif
     
+    if (timing)
+      {
+        *logs << "\nAfter routing timing:\n";
+        route_timing->report(*logs);
+      }
+    
+    if (write_routes_file)
+      {
+        *logs << "write_routes " << write_routes_file << "...\n";
+        std::string expanded = expand_filename(write_routes_file);
+        std::ofstream fs(expanded);
+        if (fs.fail())
+          fatal(fmt("write_routes: failed to open `" << expanded << "': "
+                    << strerror(errno)));
+        fs << "# " << version_str << "\n";
+        write_routes(fs, chipdb, routes);
+      }
+    
     if (output_file)
       {
         *logs << "write_txt " << output_file << "...\n";
@@ -16,11 +16,15 @@
 #include "util.hh"
 #include "chipdb.hh"
 #include "line_parser.hh"
+#include "bitvector.hh"
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <fstream>
+#include <tuple>
+#include <algorithm>
 
 std::ostream &
 operator<<(std::ostream &s, const CBit &cbit)
@@ -273,8 +277,6 @@ ChipDB::set_device(const std::string &d,
   tile_nets.resize(n_tiles);
   
   net_tile_name.resize(n_nets);
-  out_switches.resize(n_nets);
-  in_switches.resize(n_nets);
 }
 
 class ChipDBParser : public LineParser
@@ -856,33 +858,261 @@ ChipDB::finalize()
       tile_pos_cell[t][pos] = i;
     }
   
-  in_switches.resize(n_nets);
-  out_switches.resize(n_nets);
-  for (size_t s = 0;  s < switches.size(); ++s)
+  // counting sort of the switch inputs by net, edges out of a net in
+  // switch order
+  net_edge_begin.clear();
+  net_edge_begin.resize(n_nets + 1, 0);
+  for (const Switch &sw : switches)
+    for (const auto &p : sw.in_val)
+      ++net_edge_begin[p.first + 1];
+  for (int i = 0; i < n_nets; ++i)
+    net_edge_begin[i + 1] += net_edge_begin[i];
+  
+  int n_edges = net_edge_begin[n_nets];
+  edge_net.clear();
+  edge_net.resize(n_edges);
+  edge_switch.clear();
+  edge_switch.resize(n_edges);
+  std::vector<int> next_edge(net_edge_begin.begin(), net_edge_begin.end() - 1);
+  for (int s = 0; s < (int)switches.size(); ++s)
+    for (const auto &p : switches[s].in_val)
+      {
+        int e = next_edge[p.first]++;
+        assert(switches[s].out != p.first);
+        edge_net[e] = switches[s].out;
+        edge_switch[e] = s;
+      }
+  
+  // uniform for now: the lookahead counts hops
+  net_base_cost.clear();
+  net_base_cost.resize(n_nets, 1);
+  
+  std::vector<int> net_xmin(n_nets, width),
+    net_xmax(n_nets, -1),
+    net_ymin(n_nets, height),
+    net_ymax(n_nets, -1);
+  net_class.clear();
+  net_class.resize(n_nets, NetClass::OTHER);
+  BitVector classified(n_nets);
+  for (int t = 0; t < n_tiles; ++t)
+    {
+      int x = tile_x(t),
+        y = tile_y(t);
+      for (const auto &p : tile_nets[t])
+        {
+          int n = p.second;
+          net_xmin[n] = std::min(net_xmin[n], x);
+          net_xmax[n] = std::max(net_xmax[n], x);
+          net_ymin[n] = std::min(net_ymin[n], y);
+          net_ymax[n] = std::max(net_ymax[n], y);
+          
+          if (classified[n])
+            continue;
+          
+          const std::string &name = p.first;
+          if (is_prefix("glb_netwk_", name))
+            net_class[n] = NetClass::GLOBAL;
+          else if (is_prefix("local_", name)
+                   || is_prefix("glb2local_", name))
+            net_class[n] = NetClass::LOCAL;
+          else if (is_prefix("sp4_", name)
+                   || is_prefix("span4_", name))
+            net_class[n] = NetClass::SPAN4_H;
+          else if (is_prefix("sp12_", name)
+                   || is_prefix("span12_", name))
+            net_class[n] = NetClass::SPAN12_H;
+          else
+            continue;
+          classified[n] = true;
+        }
+    }
+  
+  // orientation of spans from their extent
+  for (int i = 0; i < n_nets; ++i)
     {
-      int out = switches[s].out;
-      extend(out_switches[out], s);
-      for (const auto &p : switches[s].in_val)
-        extend(in_switches[p.first], s);
+      if (net_ymax[i] - net_ymin[i] <= net_xmax[i] - net_xmin[i])
+        continue;
+      if (net_class[i] == NetClass::SPAN4_H)
+        net_class[i] = NetClass::SPAN4_V;
+      else if (net_class[i] == NetClass::SPAN12_H)
+        net_class[i] = NetClass::SPAN12_V;
     }
 }
 
+void
+ChipDB::compute_lookahead()
+{
+  std::vector<int> net_xmin(n_nets, width),
+    net_ymin(n_nets, height),
+    net_n_tiles(n_nets, 0);
+  for (int t = 0; t < n_tiles; ++t)
+    for (const auto &p : tile_nets[t])
+      {
+        int n = p.second;
+        ++net_n_tiles[n];
+        net_xmin[n] = std::min(net_xmin[n], tile_x(t));
+        net_ymin[n] = std::min(net_ymin[n], tile_y(t));
+      }
+  
+  // sinks are the single-tile nets that don't drive anything, like
+  // lutff_0/in_0
+  BitVector sink(n_nets);
+  for (int i = 0; i < n_nets; ++i)
+    sink[i] = (net_n_tiles[i] == 1
+               && net_edge_begin[i] == net_edge_begin[i + 1]);
+  
+  int n_offsets = (2*width - 1) * (2*height - 1);
+  lookahead.clear();
+  lookahead.resize(n_net_classes, std::vector<int>(n_offsets, -1));
+  
+  // Search from every net that drives something, up to max_depth
+  // hops, and keep the minimum for each class and offset.  A minimum
+  // of at most max_depth is found exactly, so the entries left unset
+  // are at least max_depth + 1.
+  const int max_depth = 4;
+  
+  std::vector<int> dist(n_nets, 0),
+    stamp(n_nets, -1);
+  std::vector<int> q;
+  for (int src = 0; src < n_nets; ++src)
+    {
+      if (net_edge_begin[src] == net_edge_begin[src + 1])
+        continue;
+      
+      std::vector<int> &table = lookahead[net_class_idx(net_class[src])];
+      q.clear();
+      stamp[src] = src;
+      dist[src] = 0;
+      q.push_back(src);
+      for (unsigned k = 0; k < q.size(); ++k)
+        {
+          int n = q[k];
+          if (sink[n])
+            {
+              int dx = net_xmin[n] - net_xmin[src],
+                dy = net_ymin[n] - net_ymin[src];
+              int &e = table[(dy + height - 1) * (2*width - 1)
+                             + (dx + width - 1)];
+              if (e < 0
+                  || dist[n] < e)
+                e = dist[n];
+            }
+          if (dist[n] == max_depth)
+            continue;
+          for (int e = net_edge_begin[n]; e < net_edge_begin[n + 1]; ++e)
+            {
+              int n2 = edge_net[e];
+              if (stamp[n2] != src)
+                {
+                  stamp[n2] = src;
+                  dist[n2] = dist[n] + 1;
+                  q.push_back(n2);
+                }
+            }
+        }
+    }
+  
+  // Beyond max_depth, search the relaxed graph on (class, offset)
+  // states with a move for each distinct (class, class of the next
+  // net or sink, anchor displacement) of the edges.  Every path maps
+  // to a relaxed path of the same length and displacement, so its
+  // distances are lower bounds too, and they keep growing with the
+  // offset where the exact search stops.
+  const int sink_class = n_net_classes;
+  std::vector<std::vector<std::tuple<int, int, int>>> moves(n_net_classes);
+  for (int n = 0; n < n_nets; ++n)
+    for (int e = net_edge_begin[n]; e < net_edge_begin[n + 1]; ++e)
+      {
+        int n2 = edge_net[e];
+        if (!sink[n2]
+            && net_edge_begin[n2] == net_edge_begin[n2 + 1])
+          continue;
+        moves[net_class_idx(net_class[n])].push_back
+          (std::make_tuple(sink[n2] ? sink_class : net_class_idx(net_class[n2]),
+                           net_xmin[n2] - net_xmin[n],
+                           net_ymin[n2] - net_ymin[n]));
+      }
+  for (auto &v : moves)
+    {
+      std::sort(v.begin(), v.end());
+      v.erase(std::unique(v.begin(), v.end()), v.end());
+    }
+  
+  std::vector<int> rdist((n_net_classes + 1) * n_offsets);
+  for (int c0 = 0; c0 < n_net_classes; ++c0)
+    {
+      std::vector<int> &table = lookahead[c0];
+      
+      std::fill(rdist.begin(), rdist.end(), -1);
+      int s0 = c0 * n_offsets + (height - 1) * (2*width - 1) + (width - 1);
+      rdist[s0] = 0;
+      q.clear();
+      q.push_back(s0);
+      for (unsigned k = 0; k < q.size(); ++k)
+        {
+          int st = q[k],
+            c = st / n_offsets,
+            off = st % n_offsets;
+          if (c == sink_class)
+            {
+              int &e = table[off];
+              if (e < 0)
+                e = std::max(max_depth + 1, rdist[st]);
+              continue;
+            }
+          
+          int dx = off % (2*width - 1) - (width - 1),
+            dy = off / (2*width - 1) - (height - 1);
+          for (const auto &m : moves[c])
+            {
+              int dx2 = dx + std::get<1>(m),
+                dy2 = dy + std::get<2>(m);
+              if (dx2 <= -width || dx2 >= width
+                  || dy2 <= -height || dy2 >= height)
+                continue;
+              int st2 = (std::get<0>(m) * n_offsets
+                         + (dy2 + height - 1) * (2*width - 1)
+                         + (dx2 + width - 1));
+              if (rdist[st2] < 0)
+                {
+                  rdist[st2] = rdist[st] + 1;
+                  q.push_back(st2);
+                }
+            }
+        }
+    }
+  
+  // unreachable even in the relaxed graph
+  for (auto &table : lookahead)
+    for (int &e : table)
+      {
+        if (e < 0)
+          e = max_depth + 1;
+      }
+}
+
 int
 ChipDB::find_switch(int in, int out) const
 {
-  std::vector<int> t;
-  std::set_intersection(out_switches[out].begin(),
-                        out_switches[out].end(),
-                        in_switches[in].begin(),
-                        in_switches[in].end(),
-                        std::back_insert_iterator<std::vector<int>>(t));
-  assert(t.size() == 1);
-  int s = t[0];
-  assert(switches[s].out == out);
-  assert(contains_key(switches[s].in_val, in));
-  return s;
+  for (int e = net_edge_begin[in]; e < net_edge_begin[in + 1]; ++e)
+    {
+      if (edge_net[e] == out)
+        {
+          int s = edge_switch[e];
+          assert(switches[s].out == out);
+          assert(contains_key(switches[s].in_val, in));
+          return s;
+        }
+    }
+  fatal(fmt("no switch from net " << in << " to net " << out));
+  return -1;
 }
 
+// Binary chipdb header.  Bump chipdb_version when the format or the
+// meaning of a precomputed table changes.
+static const char *chipdb_magic = "arachne-pnr-chipdb";
+static const int chipdb_version = 2;
+
 void
 ChipDB::bwrite(obstream &obs) const
 {
@@ -908,7 +1138,9 @@ ChipDB::bwrite(obstream &obs) const
         }
     }
   
-  obs << device
+  obs << std::string(chipdb_magic)
+      << chipdb_version
+      << device
       << width
       << height
     // n_tiles = width * height
@@ -933,8 +1165,10 @@ ChipDB::bwrite(obstream &obs) const
       << cell_type_cells
     // bank_cells
       << switches
-    // in_switches, out_switches
-      << tile_cbits_block_size;
+    // routing graph
+      << tile_cbits_block_size
+    // net_class
+      << lookahead;
 }
 
 void
@@ -943,6 +1177,18 @@ ChipDB::bread(ibstream &ibs)
   std::vector<std::string> net_names;
   std::vector<std::map<int, int>> tile_nets_idx;
   
+  // binary chipdbs without a header start with the device name
+  std::string magic;
+  ibs >> magic;
+  if (magic != chipdb_magic)
+    fatal("binary chipdb has no version header, regenerate it with --write-binary-chipdb");
+  int version;
+  ibs >> version;
+  if (version != chipdb_version)
+    fatal(fmt("binary chipdb has format version " << version
+              << ", expected " << chipdb_version
+              << ", regenerate it with --write-binary-chipdb"));
+  
   ibs >> device
       >> width
       >> height
@@ -968,8 +1214,10 @@ ChipDB::bread(ibstream &ibs)
       >> cell_type_cells
     // bank_cells
       >> switches
-    // in_switches, out_switches
-      >> tile_cbits_block_size;
+    // routing graph
+      >> tile_cbits_block_size
+    // net_class
+      >> lookahead;
   
   n_tiles = width * height;
   
@@ -140,6 +140,18 @@ enum class CellType : int {
 
 extern std::string cell_type_name(CellType ct);
 
+// wire classes distinguished by the routing lookahead
+enum class NetClass : int {
+  OTHER, LOCAL, SPAN4_H, SPAN4_V, SPAN12_H, SPAN12_V, GLOBAL,
+};
+
+constexpr int net_class_idx(NetClass nc)
+{
+  return static_cast<int>(nc);
+}
+
+static const int n_net_classes = net_class_idx(NetClass::GLOBAL) + 1;
+
 inline obstream &operator<<(obstream &obs, TileType t)
 {
   return obs << static_cast<int>(t);
@@ -269,11 +281,35 @@ public:
   // buffers and routing
   std::vector<Switch> switches;
   
-  std::vector<std::set<int>> out_switches;
-  std::vector<std::set<int>> in_switches;
+  // Routing graph in compressed sparse row form, built by finalize.
+  // The edges out of net i are net_edge_begin[i] up to
+  // net_edge_begin[i+1]: edge e enters net edge_net[e] through switch
+  // edge_switch[e].  Entering net i costs net_base_cost[i].
+  std::vector<int> net_edge_begin;
+  std::vector<int> edge_net;
+  std::vector<int> edge_switch;
+  std::vector<int> net_base_cost;
   
   std::map<TileType, std::pair<int, int>> tile_cbits_block_size;
   
+  std::vector<NetClass> net_class;
+  
+  // Routing lookahead: a lower bound on the number of hops from any
+  // net of each class to a sink net in a tile at offset (dx, dy) from
+  // the lower-left corner of the net's bbox.  Exact out to a few hops,
+  // and from the class-level wire displacements beyond.  Empty unless
+  // computed by compute_lookahead or read from a binary chipdb.
+  std::vector<std::vector<int>> lookahead;
+  
+  int lookahead_hops(NetClass nc, int dx, int dy) const
+  {
+    assert(!lookahead.empty());
+    assert(dx > -width && dx < width);
+    assert(dy > -height && dy < height);
+    return lookahead[net_class_idx(nc)][(dy + height - 1) * (2*width - 1)
+                                        + (dx + width - 1)];
+  }
+  
   int add_cell(CellType type, const Location &loc);
   bool is_global_net(int i) const { return i < n_global_nets; }
   int find_switch(int in, int out) const;
@@ -312,6 +348,7 @@ public:
   
   void set_device(const std::string &d, int w, int h, int n_nets_);
   void finalize();
+  void compute_lookahead();
   
 public:
   ChipDB();
@@ -0,0 +1,310 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "eco.hh"
+#include "util.hh"
+#include "chipdb.hh"
+#include "designstate.hh"
+#include "line_parser.hh"
+
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <fstream>
+#include <set>
+
+static void
+append_ports(std::string &key, Instance *inst, bool outputs_only)
+{
+  for (const auto &p : inst->ports())
+    {
+      Port *port = p.second;
+      if (outputs_only
+          && port->is_input())
+        continue;
+      
+      Net *n = port->connection();
+      if (!n
+          || n->is_constant())
+        continue;
+      
+      if (key.back() != ':')
+        key.push_back(',');
+      key += p.first;
+      key.push_back('=');
+      key += n->name();
+    }
+}
+
+std::string
+instance_key(Instance *inst)
+{
+  std::string key = inst->instance_of()->name();
+  key.push_back(':');
+  append_ports(key, inst, true);
+  if (key.back() == ':')
+    append_ports(key, inst, false);
+  return key;
+}
+
+// keys of the placed instances, without duplicates
+static std::map<std::string, Instance *>
+unique_keys(const DesignState &ds)
+{
+  std::map<std::string, Instance *> key_inst;
+  std::set<std::string> dup;
+  for (Instance *inst : ds.top->instances())
+    {
+      std::string key = instance_key(inst);
+      if (contains(dup, key))
+        continue;
+      if (contains_key(key_inst, key))
+        {
+          key_inst.erase(key);
+          dup.insert(key);
+          continue;
+        }
+      extend(key_inst, key, inst);
+    }
+  return key_inst;
+}
+
+void
+write_placement(std::ostream &s, const DesignState &ds)
+{
+  const ChipDB *chipdb = ds.chipdb;
+  for (const auto &p : unique_keys(ds))
+    {
+      auto i = ds.placement.find(p.second);
+      if (i == ds.placement.end())
+        continue;
+      
+      const Location &loc = chipdb->cell_location[i->second];
+      int t = loc.tile();
+      s << p.first
+        << " " << chipdb->tile_x(t)
+        << " " << chipdb->tile_y(t)
+        << " " << loc.pos() << "\n";
+    }
+}
+
+class PlacementParser : public LineParser
+{
+  const DesignState &ds;
+  std::map<Instance *, int, IdLess> &prev;
+
+public:
+  PlacementParser(const std::string &f, std::istream &s_,
+                  const DesignState &ds_,
+                  std::map<Instance *, int, IdLess> &prev_)
+    : LineParser(f, s_),
+      ds(ds_),
+      prev(prev_)
+  {}
+  
+  void parse();
+};
+
+void
+PlacementParser::parse()
+{
+  const ChipDB *chipdb = ds.chipdb;
+  std::map<std::string, Instance *> key_inst = unique_keys(ds);
+  
+  std::set<std::string> seen;
+  for (;;)
+    {
+      if (eof())
+        break;
+      
+      read_line();
+      if (words.empty())
+        continue;
+      
+      if (words.size() != 4)
+        fatal("invalid placement: expected <key> <x> <y> <pos>");
+      
+      int v[3];
+      for (int k = 0; k < 3; ++k)
+        {
+          const std::string &w = words[k + 1];
+          char *end;
+          long x = strtol(w.c_str(), &end, 10);
+          if (w.empty()
+              || *end != '\0'
+              || x < 0
+              || x > INT_MAX)
+            fatal(fmt("invalid coordinate `" << w << "'"));
+          v[k] = (int)x;
+        }
+      if (v[0] >= chipdb->width
+          || v[1] >= chipdb->height)
+        fatal(fmt("tile " << v[0] << " " << v[1] << " out of range"));
+      
+      int t = chipdb->tile(v[0], v[1]);
+      if (v[2] >= (int)chipdb->tile_pos_cell[t].size()
+          || chipdb->tile_pos_cell[t][v[2]] == 0)
+        fatal(fmt("no cell at " << v[0] << " " << v[1] << " " << v[2]));
+      int cell = chipdb->tile_pos_cell[t][v[2]];
+      
+      const std::string &key = words[0];
+      if (contains(seen, key))
+        fatal(fmt("duplicate instance `" << key << "'"));
+      seen.insert(key);
+      
+      auto i = key_inst.find(key);
+      if (i != key_inst.end())
+        extend(prev, i->second, cell);
+    }
+}
+
+std::map<Instance *, int, IdLess>
+read_placement(const std::string &filename, const DesignState &ds)
+{
+  std::string expanded = expand_filename(filename);
+  std::ifstream fs(expanded);
+  if (fs.fail())
+    fatal(fmt("read_placement: failed to open `" << expanded << "': "
+              << strerror(errno)));
+  
+  std::map<Instance *, int, IdLess> prev;
+  PlacementParser parser(filename, fs, ds, prev);
+  parser.parse();
+  return prev;
+}
+
+void
+write_routes(std::ostream &s, const ChipDB *chipdb, const NetRoutes &routes)
+{
+  // a name for each chipdb net
+  std::vector<std::pair<int, const std::string *>> cnet_name(chipdb->n_nets,
+                                                             std::make_pair(-1, nullptr));
+  for (int t = 0; t < chipdb->n_tiles; ++t)
+    for (const auto &p : chipdb->tile_nets[t])
+      {
+        if (!cnet_name[p.second].second)
+          cnet_name[p.second] = std::make_pair(t, &p.first);
+      }
+  
+  auto write_cnet = [&](int cn) {
+    int t = cnet_name[cn].first;
+    s << chipdb->tile_x(t) << " " << chipdb->tile_y(t)
+      << " " << *cnet_name[cn].second;
+  };
+  
+  for (const auto &p : routes)
+    {
+      s << "net " << p.first << "\n";
+      for (const auto &e : p.second)
+        {
+          write_cnet(e.first);
+          s << " ";
+          write_cnet(e.second);
+          s << "\n";
+        }
+    }
+}
+
+class RouteParser : public LineParser
+{
+  const ChipDB *chipdb;
+  NetRoutes &routes;
+  
+  int parse_cnet(int k);
+
+public:
+  RouteParser(const std::string &f, std::istream &s_,
+              const ChipDB *chipdb_, NetRoutes &routes_)
+    : LineParser(f, s_),
+      chipdb(chipdb_),
+      routes(routes_)
+  {}
+  
+  void parse();
+};
+
+int
+RouteParser::parse_cnet(int k)
+{
+  int v[2];
+  for (int j = 0; j < 2; ++j)
+    {
+      const std::string &w = words[k + j];
+      char *end;
+      long x = strtol(w.c_str(), &end, 10);
+      if (w.empty()
+          || *end != '\0'
+          || x < 0
+          || x >= (j ? chipdb->height : chipdb->width))
+        fatal(fmt("invalid coordinate `" << w << "'"));
+      v[j] = (int)x;
+    }
+  
+  int t = chipdb->tile(v[0], v[1]);
+  const std::string &name = words[k + 2];
+  auto i = chipdb->tile_nets[t].find(name);
+  if (i == chipdb->tile_nets[t].end())
+    fatal(fmt("no net `" << name << "' in tile " << v[0] << " " << v[1]));
+  return i->second;
+}
+
+void
+RouteParser::parse()
+{
+  std::vector<std::pair<int, int>> *route = nullptr;
+  for (;;)
+    {
+      if (eof())
+        break;
+      
+      read_line();
+      if (words.empty())
+        continue;
+      
+      if (words[0] == "net")
+        {
+          if (words.size() != 2)
+            fatal("invalid net: expected net <name>");
+          if (contains_key(routes, words[1]))
+            fatal(fmt("duplicate net `" << words[1] << "'"));
+          route = &routes[words[1]];
+          continue;
+        }
+      
+      if (!route)
+        fatal("expected net");
+      if (words.size() != 6)
+        fatal("invalid route: expected <x> <y> <wire> <x> <y> <wire>");
+      
+      int from = parse_cnet(0),
+        to = parse_cnet(3);
+      route->push_back(std::make_pair(from, to));
+    }
+}
+
+NetRoutes
+read_routes(const std::string &filename, const ChipDB *chipdb)
+{
+  std::string expanded = expand_filename(filename);
+  std::ifstream fs(expanded);
+  if (fs.fail())
+    fatal(fmt("read_routes: failed to open `" << expanded << "': "
+              << strerror(errno)));
+  
+  NetRoutes routes;
+  RouteParser parser(filename, fs, chipdb, routes);
+  parser.parse();
+  return routes;
+}
@@ -0,0 +1,55 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef PNR_ECO_HH
+#define PNR_ECO_HH
+
+#include "netlist.hh"
+
+#include <ostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+
+class ChipDB;
+class DesignState;
+
+// Placement files for incremental (ECO) runs.  Instances have no
+// names, so each one is identified by its type and the nets on its
+// outputs (or, failing those, all its ports).  A placement file has
+// one `<key> <x> <y> <pos>' line per placed instance with a unique
+// key.
+
+extern std::string instance_key(Instance *inst);
+
+extern void write_placement(std::ostream &s, const DesignState &ds);
+
+// Previous cells of the instances of ds whose keys appear in
+// filename.
+extern std::map<Instance *, int, IdLess>
+read_placement(const std::string &filename, const DesignState &ds);
+
+// Route files: a `net <name>' line for each routed net, followed by a
+// `<x> <y> <wire> <x> <y> <wire>' line for each switch on its route.
+// Routes are (from, to) chipdb net pairs by net name.
+typedef std::map<std::string, std::vector<std::pair<int, int>>> NetRoutes;
+
+extern void write_routes(std::ostream &s, const ChipDB *chipdb,
+                         const NetRoutes &routes);
+extern NetRoutes read_routes(const std::string &filename,
+                             const ChipDB *chipdb);
+
+#endif
@@ -0,0 +1,147 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef PNR_INDEXEDQ_HH
+#define PNR_INDEXEDQ_HH
+
+#include <vector>
+#include <utility>
+#include <cassert>
+
+// Binary min-heap of (value, key) pairs with at most one entry per
+// value, values being small non-negative integers.  Pushing a value
+// already in the heap changes its key in place (decrease-key), so the
+// heap never holds stale entries.  Ties are broken by smaller value.
+class IndexedQ
+{
+  std::vector<std::pair<int, int>> v;
+  // position of value in v, or -1
+  std::vector<int> pos;
+  
+  bool less(const std::pair<int, int> &lhs,
+            const std::pair<int, int> &rhs) const
+  {
+    return (lhs.second < rhs.second
+            || (lhs.second == rhs.second
+                && lhs.first < rhs.first));
+  }
+  
+  void place(int i, const std::pair<int, int> &x)
+  {
+    v[i] = x;
+    pos[x.first] = i;
+  }
+  
+  void sift_up(int i)
+  {
+    std::pair<int, int> x = v[i];
+    while (i > 0)
+      {
+        int p = (i - 1) / 2;
+        if (!less(x, v[p]))
+          break;
+        place(i, v[p]);
+        i = p;
+      }
+    place(i, x);
+  }
+  
+  void sift_down(int i)
+  {
+    std::pair<int, int> x = v[i];
+    int m = v.size();
+    for (;;)
+      {
+        int c = 2*i + 1;
+        if (c >= m)
+          break;
+        if (c + 1 < m
+            && less(v[c + 1], v[c]))
+          ++c;
+        if (!less(v[c], x))
+          break;
+        place(i, v[c]);
+        i = c;
+      }
+    place(i, x);
+  }
+  
+public:
+  IndexedQ() {}
+  
+  size_t size() const { return v.size(); }
+  bool empty() const { return v.empty(); }
+  void clear()
+  {
+    for (const auto &x : v)
+      pos[x.first] = -1;
+    v.clear();
+  }
+  
+  bool contains(int value) const
+  {
+    return (value < (int)pos.size()
+            && pos[value] >= 0);
+  }
+  
+  void push(const std::pair<int, int> &x)
+  {
+    assert(x.first >= 0);
+    if (x.first >= (int)pos.size())
+      pos.resize(x.first + 1, -1);
+    
+    int i = pos[x.first];
+    if (i < 0)
+      {
+        v.push_back(x);
+        pos[x.first] = v.size() - 1;
+        sift_up(v.size() - 1);
+      }
+    else if (less(x, v[i]))
+      {
+        v[i] = x;
+        sift_up(i);
+      }
+    else
+      {
+        v[i] = x;
+        sift_down(i);
+      }
+  }
+  
+  std::pair<int, int> pop()
+  {
+    assert(!v.empty());
+    std::pair<int, int> x = v[0];
+    pos[x.first] = -1;
+    if (v.size() > 1)
+      {
+        v[0] = v.back();
+        v.pop_back();
+        sift_down(0);
+      }
+    else
+      v.pop_back();
+    return x;
+  }
+  
+  const std::pair<int, int> &top() const
+  {
+    assert(!v.empty());
+    return v[0];
+  }
+};
+
+#endif
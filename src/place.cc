@@ -27,16 +27,405 @@
 #include "hashmap.hh"
 #include "designstate.hh"
 #include "global.hh"
+#include "timing.hh"
 
 #include <iomanip>
 #include <vector>
 #include <set>
+#include <map>
 #include <random>
 #include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <cmath>
-#include <ctime>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Bounding box of a net's terminals with the number of terminals on
+// each edge, so moving a terminal updates it in O(1) unless the last
+// terminal leaves an edge.
+class NetBox
+{
+public:
+  int xmin, xmax, ymin, ymax;
+  int n_xmin, n_xmax, n_ymin, n_ymax;
+  
+public:
+  NetBox()
+    : xmin(0), xmax(0), ymin(0), ymax(0),
+      n_xmin(0), n_xmax(0), n_ymin(0), n_ymax(0)
+  {}
+  
+  int length() const { return (xmax - xmin) + (ymax - ymin); }
+  
+  // false if the bbox must be recomputed
+  bool move(int x0, int y0, int x1, int y1)
+  {
+    return (move_edges(xmin, n_xmin, xmax, n_xmax, x0, x1)
+            && move_edges(ymin, n_ymin, ymax, n_ymax, y0, y1));
+  }
+  
+  // bbox of w_gates, with gate g in cell cell_of(g)
+  template<typename CellOf>
+  static NetBox compute(const ChipDB *chipdb, const std::vector<int> &w_gates,
+                        CellOf cell_of);
+  
+private:
+  static bool move_edges(int &lo, int &n_lo, int &hi, int &n_hi,
+                         int v0, int v1)
+  {
+    if (v0 == v1)
+      return true;
+    
+    if (v1 < lo)
+      {
+        lo = v1;
+        n_lo = 1;
+      }
+    else if (v1 == lo)
+      ++n_lo;
+    if (v1 > hi)
+      {
+        hi = v1;
+        n_hi = 1;
+      }
+    else if (v1 == hi)
+      ++n_hi;
+    
+    bool ok = true;
+    if (v0 == lo
+        && --n_lo == 0)
+      ok = false;
+    if (v0 == hi
+        && --n_hi == 0)
+      ok = false;
+    return ok;
+  }
+};
+
+template<typename CellOf> NetBox
+NetBox::compute(const ChipDB *chipdb, const std::vector<int> &w_gates,
+                CellOf cell_of)
+{
+  assert(!w_gates.empty());
+  
+  NetBox b;
+  for (int i = 0; i < (int)w_gates.size(); ++i)
+    {
+      int t = chipdb->cell_location[cell_of(w_gates[i])].tile();
+      int x = chipdb->tile_x(t),
+        y = chipdb->tile_y(t);
+      if (i == 0)
+        {
+          b.xmin = b.xmax = x;
+          b.ymin = b.ymax = y;
+        }
+      
+      if (x < b.xmin)
+        {
+          b.xmin = x;
+          b.n_xmin = 0;
+        }
+      if (x == b.xmin)
+        ++b.n_xmin;
+      if (x > b.xmax)
+        {
+          b.xmax = x;
+          b.n_xmax = 0;
+        }
+      if (x == b.xmax)
+        ++b.n_xmax;
+      
+      if (y < b.ymin)
+        {
+          b.ymin = y;
+          b.n_ymin = 0;
+        }
+      if (y == b.ymin)
+        ++b.n_ymin;
+      if (y > b.ymax)
+        {
+          b.ymax = y;
+          b.n_ymax = 0;
+        }
+      if (y == b.ymax)
+        ++b.n_ymax;
+    }
+  
+  assert(b.xmin <= b.xmax && b.ymin <= b.ymax);
+  return b;
+}
+
+// Routing demand by tile (RUDY: the sum over nets of the net's length
+// divided by the area of its bbox on each tile of the bbox), with the
+// previous demand of the tiles changed by the current move.
+class DemandMap
+{
+public:
+  const ChipDB *chipdb;
+  const std::vector<double> *capacity;
+  std::vector<double> demand;
+  UllmanSet touched;
+  std::vector<std::pair<int, double>> restore_demand;
+  
+public:
+  DemandMap()
+    : chipdb(nullptr),
+      capacity(nullptr)
+  {}
+  
+  void init(const ChipDB *chipdb_, const std::vector<double> *capacity_)
+  {
+    chipdb = chipdb_;
+    capacity = capacity_;
+    demand.resize(chipdb->n_tiles, 0.0);
+    touched.resize(chipdb->n_tiles);
+  }
+  
+  double overflow(int t) const
+  {
+    return std::max(0.0, demand[t] - (*capacity)[t]);
+  }
+  double total_overflow() const;
+  
+  void add_net(const NetBox &b, double sign);
+  // change in overflow since the last clear
+  double overflow_delta() const;
+  void restore();
+  void clear();
+};
+
+void
+DemandMap::add_net(const NetBox &b, double sign)
+{
+  int area = (b.xmax - b.xmin + 1) * (b.ymax - b.ymin + 1);
+  double density = sign * b.length() / area;
+  for (int x = b.xmin; x <= b.xmax; ++x)
+    for (int y = b.ymin; y <= b.ymax; ++y)
+      {
+        int t = chipdb->tile(x, y);
+        if (!touched.contains(t))
+          {
+            touched.insert(t);
+            restore_demand.push_back(std::make_pair(t, demand[t]));
+          }
+        demand[t] += density;
+      }
+}
+
+double
+DemandMap::overflow_delta() const
+{
+  double delta = 0.0;
+  for (const auto &p : restore_demand)
+    {
+      int t = p.first;
+      delta += overflow(t) - std::max(0.0, p.second - (*capacity)[t]);
+    }
+  return delta;
+}
+
+double
+DemandMap::total_overflow() const
+{
+  double c = 0.0;
+  for (int t = 0; t < (int)demand.size(); ++t)
+    c += overflow(t);
+  return c;
+}
+
+void
+DemandMap::restore()
+{
+  for (const auto &p : restore_demand)
+    demand[p.first] = p.second;
+}
+
+void
+DemandMap::clear()
+{
+  touched.clear();
+  restore_demand.clear();
+}
+
+// The nets touched by the current move, with their length and bbox
+// before it, and those whose bbox needs a rescan.  The lengths and
+// bboxes live in a view of the placement, the Placer's or a
+// PlaceWorker's, with members int &length_ref(int w), NetBox
+// &box_ref(int w) and NetBox compute_net_box(int w).
+class NetJournal
+{
+public:
+  UllmanSet recompute;
+  UllmanSet rescan;
+  std::vector<std::tuple<int, int, NetBox>> restore_net;
+  
+public:
+  void resize(int n_nets)
+  {
+    recompute.resize(n_nets);
+    rescan.resize(n_nets);
+  }
+  
+  // the nets w_nets of a gate moving from (x0, y0) to (x1, y1)
+  template<typename View>
+  void move_nets(View &v, const std::vector<int> &w_nets,
+                 const BitVector &net_global,
+                 int x0, int y0, int x1, int y1);
+  
+  // update the lengths of the touched nets and return the change in
+  // wire length, weighted by net_weight if not empty
+  template<typename View>
+  double recompute_length(View &v, const std::vector<double> &net_weight);
+  
+  // move the touched nets' demand in dm to their new bboxes and return
+  // the change in overflow
+  template<typename View>
+  double recompute_demand(View &v, DemandMap &dm);
+  
+  template<typename View>
+  void restore(View &v);
+  
+  void clear()
+  {
+    recompute.clear();
+    rescan.clear();
+    restore_net.clear();
+  }
+};
+
+template<typename View> void
+NetJournal::move_nets(View &v, const std::vector<int> &w_nets,
+                      const BitVector &net_global,
+                      int x0, int y0, int x1, int y1)
+{
+  for (int w : w_nets)
+    {
+      // global nets have length 0
+      if (net_global[w])
+        continue;
+      
+      if (!recompute.contains(w))
+        {
+          recompute.insert(w);
+          restore_net.push_back(std::make_tuple(w, v.length_ref(w), v.box_ref(w)));
+        }
+      if (!rescan.contains(w)
+          && !v.box_ref(w).move(x0, y0, x1, y1))
+        rescan.insert(w);
+    }
+}
+
+template<typename View> double
+NetJournal::recompute_length(View &v, const std::vector<double> &net_weight)
+{
+  double delta = 0.0;
+  for (const auto &r : restore_net)
+    {
+      int w = std::get<0>(r);
+      NetBox &b = v.box_ref(w);
+      if (rescan.contains(w))
+        b = v.compute_net_box(w);
+      int &length = v.length_ref(w);
+      int new_length = b.length();
+      if (net_weight.empty())
+        delta += (new_length - length);
+      else
+        delta += net_weight[w] * (new_length - length);
+      length = new_length;
+    }
+  return delta;
+}
+
+template<typename View> double
+NetJournal::recompute_demand(View &v, DemandMap &dm)
+{
+  for (const auto &r : restore_net)
+    {
+      const NetBox &b = std::get<2>(r),
+        &new_b = v.box_ref(std::get<0>(r));
+      if (b.xmin == new_b.xmin
+          && b.xmax == new_b.xmax
+          && b.ymin == new_b.ymin
+          && b.ymax == new_b.ymax)
+        continue;
+      dm.add_net(b, -1.0);
+      dm.add_net(new_b, 1.0);
+    }
+  return dm.overflow_delta();
+}
+
+template<typename View> void
+NetJournal::restore(View &v)
+{
+  for (const auto &r : restore_net)
+    {
+      int w = std::get<0>(r);
+      v.length_ref(w) = std::get<1>(r);
+      v.box_ref(w) = std::get<2>(r);
+    }
+}
+
+// Reference-counted state of the gates in a LOGIC tile, kept up to date
+// by Placer::set_cell_gate.
+class PLBState
+{
+public:
+  int n_gates;
+  // bit q: cell q has a gate
+  unsigned occupied;
+  // (np, refs) for the local inputs of the gates, see gate_local_np
+  std::vector<std::pair<int, int>> local_np;
+  // clk, sr, cen: bit q set if the gate in cell q has one, and (net,
+  // refs) of the nets
+  unsigned ctrl_mask[3];
+  std::vector<std::pair<int, int>> ctrl_nets[3];
+  int n_neg_clk;
+  
+public:
+  PLBState()
+    : n_gates(0), occupied(0), n_neg_clk(0)
+  {
+    for (int k = 0; k < 3; ++k)
+      ctrl_mask[k] = 0;
+  }
+  
+  static void update_refs(std::vector<std::pair<int, int>> &v, int x, int d)
+  {
+    for (unsigned i = 0; i < v.size(); ++i)
+      {
+        if (v[i].first == x)
+          {
+            v[i].second += d;
+            assert(v[i].second >= 0);
+            if (v[i].second == 0)
+              {
+                v[i] = v.back();
+                v.pop_back();
+              }
+            return;
+          }
+      }
+    assert(d > 0);
+    v.push_back(std::make_pair(x, d));
+  }
+  
+  static bool contains_ref(const std::vector<std::pair<int, int>> &v, int x)
+  {
+    for (const auto &p : v)
+      {
+        if (p.first == x)
+          return true;
+      }
+    return false;
+  }
+};
+
+class PlaceWorker;
 
 class Placer
 {
@@ -75,9 +464,31 @@ public:
   
   BasedVector<int, 1> gate_clk, gate_sr, gate_cen, gate_latch;
   
+  // legality attributes used by valid(), so it doesn't look up
+  // parameters or ports
+  BasedVector<int, 1> gate_neg_clk;
+  BasedBitVector<1> gate_lvds_input,
+    gate_neg_trigger,
+    gate_is_gb_io,
+    gate_drives_gbuf,  // GLOBAL_BUFFER_OUTPUT of gb, gb_io connected
+    gate_d_in_0,
+    gate_pll_global_a,
+    gate_pll_global_b,
+    gate_pll_2out;
+  BasedVector<int, 1> gate_io_cen, gate_io_inclk, gate_io_outclk;
+  BasedVector<int, 1> gate_gc;
+  
+  // global driven by a gb_io or gb in the cell, -1 if none; for PLL
+  // cells, the globals and io cells of PLLOUT_A and PLLOUT_B
+  BasedVector<int, 1> cell_glb;
+  BasedVector<int, 1> cell_pll_glb_a, cell_pll_glb_b,
+    cell_pll_io_a, cell_pll_io_b;
+  
   BasedVector<std::vector<int>, 1> gate_local_np;
   UllmanSet tmp_local_np;
   
+  std::vector<PLBState> plb_state;
+  
   BitVector net_global;
   
   std::vector<int> free_gates;
@@ -85,6 +496,19 @@ public:
   BasedVector<int, 1> gate_chain;
   
   CellType gate_cell_type(int g);
+  
+  // Cells of each type by column, sorted by row: the cells of type ct
+  // in column x and rows y and above start at
+  // type_col_cells[ct][x][type_col_row[ct][x][y]].  type_prefix[ct]
+  // counts the cells of type ct in columns < x and rows < y at
+  // x*(height+1) + y.
+  std::vector<std::vector<std::vector<int>>> type_col_cells;
+  std::vector<std::vector<std::vector<int>>> type_col_row;
+  std::vector<std::vector<int>> type_prefix;
+  
+  int window_count(int ct_idx, int x0, int x1, int y0, int y1) const;
+  int window_random_cell(random_generator &r, int ct_idx,
+                         int x0, int x1, int y0, int y1) const;
   int gate_random_cell(int g);
   std::pair<Location, bool> chain_random_loc(int c);
   
@@ -106,33 +530,104 @@ public:
   UllmanSet changed_tiles;
   std::vector<std::pair<int, int>> restore_cell;
   std::vector<std::tuple<int, int, int>> restore_chain;
-  std::vector<std::pair<int, int>> restore_net_length;
-  UllmanSet recompute;
+  NetJournal journal;
   
+  void update_plb_state(int t, int q, int g, int delta);
+  void set_cell_gate(int cell, int g);
   void save_set(int cell, int g);
   
   void save_set_chain(int c, int x, int start);
-  int save_recompute_wire_length();
   void restore();
   void discard();
   void accept_or_restore();
   
   std::vector<int> chain_x, chain_start;
   
+  // Committed chain positions by column: chain starting row -> chain,
+  // and the lengths of the free row intervals between chains, in rows
+  // 1 to height-2.  Updated by discard.
+  std::vector<std::map<int, int>> column_chains;
+  std::vector<std::multiset<int>> column_gaps;
+  
+  int chain_tiles(int c) const { return (chains.chains[c].size() + 7) / 8; }
+  void column_gap_bounds(int x, int start, int end, int &lo, int &hi) const;
+  void insert_column_chain(int c);
+  void erase_column_chain(int c, int x, int start);
+  
   BasedVector<int, 1> gate_cell;
   BasedVector<int, 1> cell_gate;
   
   std::vector<int> net_length;
+  std::vector<NetBox> net_box;
   
-  bool inst_drives_global(Instance *inst, int c, int glb);
+  int &length_ref(int w) { return net_length[w]; }
+  NetBox &box_ref(int w) { return net_box[w]; }
+  
+  bool gate_drives_global(int g, int c, int glb);
   bool valid_global(int glb);
   bool valid(int t);
   
   int wire_length() const;
+  NetBox compute_net_box(int w);
   int compute_net_length(int w);
   unsigned top_port_io_gate(const std::string &net_name);
   
   void place_initial();
+  
+  // Quadratic placement of the free LC gates around the gates placed
+  // by place_initial: minimize the squared wire length (clique model
+  // for small nets, star model for large) with conjugate gradient,
+  // spread the solution by recursive bisection over the free LC
+  // capacity, re-solve with anchors at the spread positions, and
+  // legalize.  Leaves the greedy placement and returns false if
+  // legalization fails.
+  bool analytic;
+  double analytic_temp;
+  void spread(const std::vector<int> &vars,
+              const std::vector<double> &x,
+              const std::vector<double> &y,
+              const std::vector<std::vector<int>> &cap,
+              int x0, int x1, int y0, int y1,
+              std::vector<int> &target_x,
+              std::vector<int> &target_y);
+  bool place_analytic();
+  
+  PlaceEffort effort;
+  double time_budget;
+  
+  // Routing congestion: the move cost adds congestion_weight times the
+  // change in demand exceeding tile_capacity, derived from the span4
+  // and span12 tracks in each tile.
+  double congestion_weight;
+  std::vector<double> tile_capacity;
+  DemandMap demand;
+  
+  void compute_demand();
+  double congestion() const { return demand.total_overflow(); }
+  
+  // Detailed placement after annealing: move each free LC gate toward
+  // the median optimal region of its nets, then try swaps among the
+  // gates within small windows.  Only improving moves are kept.
+  bool detail;
+  bool optimal_region_move(int g);
+  void window_swaps(int window);
+  void detail_place();
+  
+  // Timing-driven annealing: the placer's copy of the timing graph,
+  // re-analyzed with the current placement to weight the nets'
+  // lengths in the move cost.
+  std::unique_ptr<TimingGraph> timing;
+  double timing_weight;
+  std::vector<double> net_weight;
+  void update_timing();
+  
+  // ECO placement: previous cells by gate, 0 if none
+  const std::map<Instance *, int, IdLess> *eco_placement;
+  bool eco_lock;
+  double eco_temp;
+  BasedVector<int, 1> eco_cell;
+  BasedBitVector<1> eco_seeded;
+  
   void configure_io(const Location &loc,
                     bool enable_input,
                     bool pullup);
@@ -142,12 +637,410 @@ public:
   void check();
 #endif
   
+  // Region-parallel annealing: the LOGIC columns are split into
+  // n_region_threads strips, and each worker moves the free LC gates
+  // in its strip within the strip.  Nets with gates in several strips
+  // are evaluated by each worker against the other strips' positions
+  // at the start of the sweep and recomputed after it.  Workers cost
+  // moves like the placer, with the net weights, and congestion
+  // against a copy of the demand at the start of the sweep.
+  //
+  // Workers 1 and up run on threads started once for the whole
+  // anneal, which wait for each sweep_generation and report back
+  // through sweep_pending; worker 0 runs on the calling thread.
+  int n_region_threads;
+  std::vector<std::unique_ptr<PlaceWorker>> workers;
+  std::vector<std::thread> worker_threads;
+  std::mutex sweep_mutex;
+  std::condition_variable sweep_start, sweep_done;
+  int sweep_generation;
+  int sweep_pending;
+  bool sweep_stop;
+  std::vector<int> logic_free_gates, other_free_gates;
+  BasedVector<int, 1> gate_owner;
+  BasedVector<int, 1> gate_cell_snapshot;
+  std::vector<int> net_owner;
+  
+  void start_workers();
+  void run_worker(int k);
+  void stop_workers();
+  void parallel_sweep(int iter);
+  
 public:
-  Placer(random_generator &rg_, DesignState &ds_);
+  // annealing progress, *logs unless running in a thread
+  std::ostream *plogs;
+  
+  Placer(random_generator &rg_, DesignState &ds_, const PlaceOptions &opts);
   
+  void anneal();
+  void finish();
   void place();
+  
+  int final_wire_length() const { return wire_length(); }
+};
+
+class PlaceWorker
+{
+public:
+  Placer &placer;
+  const ChipDB *chipdb;
+  int id;
+  random_generator rg;
+  
+  // columns of the region
+  int xmin, xmax;
+  std::vector<int> gates;
+  
+  bool move_failed;
+  UllmanSet changed_tiles;
+  std::vector<std::pair<int, int>> restore_cell;
+  NetJournal journal;
+  
+  // private copy of the placer's demand at the start of the sweep
+  DemandMap demand;
+  
+  // private length and bbox of the nets shared with other workers
+  UllmanSet shared_nets;
+  std::vector<int> shared_length;
+  std::vector<NetBox> shared_box;
+  
+  int n_move;
+  int n_accept;
+  bool improved;
+  
+  int view_cell(int g) const
+  {
+    return (placer.gate_owner[g] == id
+            ? placer.gate_cell[g]
+            : placer.gate_cell_snapshot[g]);
+  }
+  
+  int &length_ref(int w);
+  NetBox &box_ref(int w);
+  NetBox compute_net_box(int w) const;
+  
+  int random_cell(int g);
+  void move_gate(int g, int new_cell);
+  void save_set(int cell, int g);
+  void restore();
+  void accept_or_restore();
+  
+public:
+  PlaceWorker(Placer &placer_, int id_, unsigned seed);
+  
+  void sweep();
 };
 
+PlaceWorker::PlaceWorker(Placer &placer_, int id_, unsigned seed)
+  : placer(placer_),
+    chipdb(placer.chipdb),
+    id(id_),
+    rg(seed),
+    xmin(0),
+    xmax(-1),
+    move_failed(false),
+    changed_tiles(chipdb->n_tiles),
+    shared_nets(placer.nets.size()),
+    shared_length(placer.nets.size(), 0),
+    shared_box(placer.nets.size()),
+    n_move(0),
+    n_accept(0),
+    improved(false)
+{
+  journal.resize(placer.nets.size());
+  if (placer.congestion_weight > 0.0)
+    demand.init(chipdb, &placer.tile_capacity);
+}
+
+int &
+PlaceWorker::length_ref(int w)
+{
+  if (placer.net_owner[w] == id)
+    return placer.net_length[w];
+  
+  if (!shared_nets.contains(w))
+    {
+      shared_nets.insert(w);
+      shared_length[w] = placer.net_length[w];
+      shared_box[w] = placer.net_box[w];
+    }
+  return shared_length[w];
+}
+
+NetBox &
+PlaceWorker::box_ref(int w)
+{
+  if (placer.net_owner[w] == id)
+    return placer.net_box[w];
+  
+  length_ref(w);
+  return shared_box[w];
+}
+
+NetBox
+PlaceWorker::compute_net_box(int w) const
+{
+  return NetBox::compute(chipdb, placer.net_gates[w],
+                         [this](int g) { return view_cell(g); });
+}
+
+int
+PlaceWorker::random_cell(int g)
+{
+  int t = chipdb->cell_location[placer.gate_cell[g]].tile();
+  int x = chipdb->tile_x(t),
+    y = chipdb->tile_y(t);
+  return placer.window_random_cell(rg, cell_type_idx(CellType::LOGIC),
+                                   std::max(xmin, x - placer.diameter),
+                                   std::min(xmax, x + placer.diameter),
+                                   std::max(0, y - placer.diameter),
+                                   std::min(chipdb->height-1, y + placer.diameter));
+}
+
+void
+PlaceWorker::move_gate(int g, int new_cell)
+{
+  int cell = placer.gate_cell[g]; // copy
+  if (new_cell == cell)
+    return;
+  
+  int new_g = placer.cell_gate[new_cell];
+  if (new_g && placer.locked[new_g])
+    {
+      move_failed = true;
+      return;
+    }
+  
+  save_set(new_cell, g);
+  save_set(cell, new_g);
+}
+
+void
+PlaceWorker::save_set(int cell, int g)
+{
+  int t = chipdb->cell_location[cell].tile();
+  assert(chipdb->tile_type[t] == TileType::LOGIC);
+  
+  restore_cell.push_back(std::make_pair(cell, placer.cell_gate[cell]));
+  if (g)
+    {
+      assert(placer.gate_owner[g] == id);
+      int t0 = chipdb->cell_location[placer.gate_cell[g]].tile();
+      journal.move_nets(*this, placer.gate_nets[g], placer.net_global,
+                        chipdb->tile_x(t0), chipdb->tile_y(t0),
+                        chipdb->tile_x(t), chipdb->tile_y(t));
+      placer.gate_cell[g] = cell;
+    }
+  
+  placer.set_cell_gate(cell, g);
+  changed_tiles.insert(t);
+}
+
+void
+PlaceWorker::restore()
+{
+  move_failed = false;
+  demand.restore();
+  for (const auto &p : restore_cell)
+    {
+      placer.set_cell_gate(p.first, p.second);
+      if (p.second)
+        placer.gate_cell[p.second] = p.first;
+    }
+  journal.restore(*this);
+}
+
+void
+PlaceWorker::accept_or_restore()
+{
+  double delta;
+  
+  if (move_failed)
+    goto L;
+  for (int i = 0; i < (int)changed_tiles.size(); ++i)
+    {
+      if (!placer.valid(changed_tiles.ith(i)))
+        goto L;
+    }
+  
+  delta = journal.recompute_length(*this, placer.net_weight);
+  if (placer.congestion_weight > 0.0)
+    delta += placer.congestion_weight * journal.recompute_demand(*this, demand);
+  
+  ++n_move;
+  if (delta < 0
+      || (placer.temp > 1e-6
+          && rg.random_real(0.0, 1.0) <= exp(-delta/placer.temp)))
+    {
+      if (delta < 0)
+        improved = true;
+      ++n_accept;
+    }
+  else
+    {
+    L:
+      restore();
+    }
+  
+  changed_tiles.clear();
+  restore_cell.clear();
+  journal.clear();
+  demand.clear();
+}
+
+void
+PlaceWorker::sweep()
+{
+  for (int g : gates)
+    {
+      int new_cell = random_cell(g);
+      
+      int new_g = placer.cell_gate[new_cell];
+      if (new_g
+          && placer.chained[new_g])
+        continue;
+      
+      assert(!move_failed);
+      move_gate(g, new_cell);
+      accept_or_restore();
+    }
+}
+
+void
+Placer::start_workers()
+{
+  for (int k = 1; k < (int)workers.size(); ++k)
+    worker_threads.push_back(std::thread([this, k]() { run_worker(k); }));
+}
+
+void
+Placer::run_worker(int k)
+{
+  int generation = 0;
+  for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(sweep_mutex);
+        sweep_start.wait(lock, [this, generation]() {
+            return sweep_stop || sweep_generation != generation;
+          });
+        if (sweep_stop)
+          return;
+        generation = sweep_generation;
+      }
+      
+      workers[k]->sweep();
+      
+      std::lock_guard<std::mutex> lock(sweep_mutex);
+      if (--sweep_pending == 0)
+        sweep_done.notify_one();
+    }
+}
+
+void
+Placer::stop_workers()
+{
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    sweep_stop = true;
+  }
+  sweep_start.notify_all();
+  for (auto &t : worker_threads)
+    t.join();
+  worker_threads.clear();
+}
+
+void
+Placer::parallel_sweep(int iter)
+{
+  int n = workers.size();
+  
+  // strip boundaries, shifted by half a strip on odd iterations
+  int w = chipdb->width;
+  int offset = (iter & 1) ? w / (2 * n) : 0;
+  for (int k = 0; k < n; ++k)
+    {
+      PlaceWorker &wk = *workers[k];
+      wk.xmin = (k == 0) ? 0 : offset + (k * w) / n;
+      wk.xmax = (k == n - 1) ? w - 1 : offset + ((k + 1) * w) / n - 1;
+      wk.gates.clear();
+      wk.shared_nets.clear();
+      if (congestion_weight > 0.0)
+        wk.demand.demand = demand.demand;
+      wk.n_move = 0;
+      wk.n_accept = 0;
+      wk.improved = false;
+    }
+  
+  for (int g = 1; g <= n_gates; ++g)
+    {
+      gate_owner[g] = -1;
+      gate_cell_snapshot[g] = gate_cell[g];
+    }
+  for (int g : logic_free_gates)
+    {
+      int x = chipdb->tile_x(chipdb->cell_location[gate_cell[g]].tile());
+      for (int k = 0; k < n; ++k)
+        {
+          if (x >= workers[k]->xmin
+              && x <= workers[k]->xmax)
+            {
+              gate_owner[g] = k;
+              workers[k]->gates.push_back(g);
+              break;
+            }
+        }
+    }
+  
+  // -2: no gate moves in the sweep, -1: gates in several regions
+  for (int i = 0; i < (int)nets.size(); ++i)
+    {
+      int owner = -2;
+      for (int g : net_gates[i])
+        {
+          int k = gate_owner[g];
+          if (k < 0)
+            continue;
+          if (owner == -2)
+            owner = k;
+          else if (owner != k)
+            {
+              owner = -1;
+              break;
+            }
+        }
+      net_owner[i] = owner;
+    }
+  
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    sweep_pending = n - 1;
+    ++sweep_generation;
+  }
+  sweep_start.notify_all();
+  workers[0]->sweep();
+  {
+    std::unique_lock<std::mutex> lock(sweep_mutex);
+    sweep_done.wait(lock, [this]() { return sweep_pending == 0; });
+  }
+  
+  for (int k = 0; k < n; ++k)
+    {
+      PlaceWorker &wk = *workers[k];
+      n_move += wk.n_move;
+      n_accept += wk.n_accept;
+      if (wk.improved)
+        improved = true;
+      
+      for (int i = 0; i < (int)wk.shared_nets.size(); ++i)
+        {
+          int w2 = wk.shared_nets.ith(i);
+          net_box[w2] = compute_net_box(w2);
+          net_length[w2] = net_box[w2].length();
+        }
+    }
+}
+
 CellType
 Placer::gate_cell_type(int g)
 {
@@ -169,56 +1062,95 @@ Placer::gate_cell_type(int g)
     }
 }
 
+int
+Placer::window_count(int ct_idx, int x0, int x1, int y0, int y1) const
+{
+  const std::vector<int> &pre = type_prefix[ct_idx];
+  int h = chipdb->height + 1;
+  return (pre[(x1 + 1)*h + (y1 + 1)]
+          - pre[x0*h + (y1 + 1)]
+          - pre[(x1 + 1)*h + y0]
+          + pre[x0*h + y0]);
+}
+
+int
+Placer::window_random_cell(random_generator &r, int ct_idx,
+                           int x0, int x1, int y0, int y1) const
+{
+  int n = window_count(ct_idx, x0, x1, y0, y1);
+  assert(n > 0);
+  int k = r.random_int(0, n - 1);
+  
+  // first column whose cells bring the count past k
+  int lo = x0,
+    hi = x1;
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (window_count(ct_idx, x0, mid, y0, y1) > k)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+  if (lo > x0)
+    k -= window_count(ct_idx, x0, lo - 1, y0, y1);
+  
+  return type_col_cells[ct_idx][lo][type_col_row[ct_idx][lo][y0] + k];
+}
+
 int
 Placer::gate_random_cell(int g)
 {
-  CellType ct = gate_cell_type(g);
-  if (ct == CellType::LOGIC)
-    {
-      int cell = gate_cell[g];
-      int t = chipdb->cell_location[cell].tile();
-      int x = chipdb->tile_x(t),
-        y = chipdb->tile_y(t);
-      
-    L:
-      int new_x = rg.random_int(std::max(0, x - diameter),
-                                std::min(chipdb->width-1, x + diameter)),
-        new_y = rg.random_int(std::max(0, y - diameter),
-                              std::min(chipdb->height-1, y + diameter));
-      int new_t = chipdb->tile(new_x, new_y);
-      if (chipdb->tile_type[new_t] != TileType::LOGIC)
-        goto L;
-      
-      Location loc(new_t, rg.random_int(0, 7));
-      return chipdb->loc_cell(loc);
-    }
-  else
-    {
-      int ct_idx = cell_type_idx(ct);
-      return random_element(chipdb->cell_type_cells[ct_idx], rg);
-    }
+  int ct_idx = cell_type_idx(gate_cell_type(g));
+  int t = chipdb->cell_location[gate_cell[g]].tile();
+  int x = chipdb->tile_x(t),
+    y = chipdb->tile_y(t);
+  return window_random_cell(rg, ct_idx,
+                            std::max(0, x - diameter),
+                            std::min(chipdb->width-1, x + diameter),
+                            std::max(0, y - diameter),
+                            std::min(chipdb->height-1, y + diameter));
 }
 
 std::pair<Location, bool>
 Placer::chain_random_loc(int c)
 {
-  const auto &v = chains.chains[c];
-  int nt = (v.size() + 7) / 8;
+  int nt = chain_tiles(c);
   
   int new_x = random_element(logic_columns, rg);
+  const auto &gaps = column_gaps[new_x];
+  if (gaps.empty()
+      || *gaps.rbegin() < nt)
+    return std::make_pair(Location(), false);
+  
   int new_start = random_int(1, chipdb->height - 2 - (nt - 1), rg);
   int new_end = new_start + nt - 1;
   
-  for (unsigned e = 0; e < chains.chains.size(); ++e)
+  // Chains in the column (including self) must lie either outside
+  // the new interval or inside it.  Chains in a column are disjoint,
+  // so only the last one starting at or before new_end and the last
+  // one starting before new_start can violate this.
+  const auto &m = column_chains[new_x];
+  auto i = m.upper_bound(new_end);
+  if (i != m.begin())
     {
-      if (chain_x[e] != new_x)  // including self
-        continue;
-      
-      int e_nt = (chains.chains[e].size() + 7) / 8;
-      int e_start = chain_start[e],
-        e_end = e_start + e_nt - 1;
-      if ((new_start > e_start && new_start <= e_end)
-          || (new_end >= e_start && new_end < e_end))
+      --i;
+      int e_start = i->first,
+        e_end = e_start + chain_tiles(i->second) - 1;
+      if (e_start >= new_start)
+        {
+          if (e_end > new_end)
+            return std::make_pair(Location(), false);
+          
+          auto j = m.lower_bound(new_start);
+          if (j != m.begin())
+            {
+              --j;
+              if (j->first + chain_tiles(j->second) - 1 >= new_start)
+                return std::make_pair(Location(), false);
+            }
+        }
+      else if (e_end >= new_start)
         return std::make_pair(Location(), false);
     }
   
@@ -226,6 +1158,64 @@ Placer::chain_random_loc(int c)
   return std::make_pair(Location(t, 0), true);
 }
 
+void
+Placer::column_gap_bounds(int x, int start, int end, int &lo, int &hi) const
+{
+  // free rows around [start, end] in column x, which holds no chain
+  // overlapping it
+  const auto &m = column_chains[x];
+  auto i = m.upper_bound(end);
+  hi = (i == m.end()) ? chipdb->height - 2 : i->first - 1;
+  if (i == m.begin())
+    lo = 1;
+  else
+    {
+      --i;
+      assert(i->first < start);
+      lo = i->first + chain_tiles(i->second);
+    }
+}
+
+void
+Placer::insert_column_chain(int c)
+{
+  int x = chain_x[c],
+    start = chain_start[c],
+    end = start + chain_tiles(c) - 1;
+  
+  int lo, hi;
+  column_gap_bounds(x, start, end, lo, hi);
+  
+  auto &gaps = column_gaps[x];
+  gaps.erase(gaps.find(hi - lo + 1));
+  if (start > lo)
+    gaps.insert(start - lo);
+  if (hi > end)
+    gaps.insert(hi - end);
+  
+  extend(column_chains[x], start, c);
+}
+
+void
+Placer::erase_column_chain(int c, int x, int start)
+{
+  int end = start + chain_tiles(c) - 1;
+  
+  auto &m = column_chains[x];
+  assert(m.at(start) == c);
+  m.erase(start);
+  
+  int lo, hi;
+  column_gap_bounds(x, start, end, lo, hi);
+  
+  auto &gaps = column_gaps[x];
+  if (start > lo)
+    gaps.erase(gaps.find(start - lo));
+  if (hi > end)
+    gaps.erase(gaps.find(hi - end));
+  gaps.insert(hi - lo + 1);
+}
+
 void
 Placer::move_gate(int g, int new_cell)
 {
@@ -297,6 +1287,55 @@ Placer::tile_n_pos(int t)
     }
 }
 
+void
+Placer::update_plb_state(int t, int q, int g, int delta)
+{
+  PLBState &st = plb_state[t];
+  
+  st.n_gates += delta;
+  if (delta > 0)
+    st.occupied |= (1u << q);
+  else
+    st.occupied &= ~(1u << q);
+  
+  for (int np : gate_local_np[g])
+    PLBState::update_refs(st.local_np, np ^ (q & 1), delta);
+  
+  int ctrl[3] = { gate_clk[g], gate_sr[g], gate_cen[g] };
+  for (int k = 0; k < 3; ++k)
+    {
+      if (!ctrl[k])
+        continue;
+      PLBState::update_refs(st.ctrl_nets[k], ctrl[k], delta);
+      if (delta > 0)
+        st.ctrl_mask[k] |= (1u << q);
+      else
+        st.ctrl_mask[k] &= ~(1u << q);
+    }
+  
+  if (gate_neg_clk[g])
+    st.n_neg_clk += delta;
+}
+
+void
+Placer::set_cell_gate(int cell, int g)
+{
+  int old_g = cell_gate[cell];
+  if (old_g == g)
+    return;
+  
+  const Location &loc = chipdb->cell_location[cell];
+  int t = loc.tile();
+  if (chipdb->tile_type[t] == TileType::LOGIC)
+    {
+      if (old_g)
+        update_plb_state(t, loc.pos(), old_g, -1);
+      if (g)
+        update_plb_state(t, loc.pos(), g, 1);
+    }
+  cell_gate[cell] = g;
+}
+
 void
 Placer::save_set(int cell, int g)
 {
@@ -306,8 +1345,10 @@ Placer::save_set(int cell, int g)
   restore_cell.push_back(std::make_pair(cell, cell_gate[cell]));
   if (g)
     {
-      for (int w : gate_nets[g])
-        recompute.insert(w);
+      int t0 = chipdb->cell_location[gate_cell[g]].tile();
+      journal.move_nets(*this, gate_nets[g], net_global,
+                        chipdb->tile_x(t0), chipdb->tile_y(t0),
+                        chipdb->tile_x(t), chipdb->tile_y(t));
       gate_cell[g] = cell;
       
       int c = gate_chain[g];
@@ -319,7 +1360,7 @@ Placer::save_set(int cell, int g)
         }
     }
   
-  cell_gate[cell] = g;
+  set_cell_gate(cell, g);
   
   changed_tiles.insert(t);
   for (int t2 : related_tiles[t])
@@ -334,34 +1375,31 @@ Placer::save_set_chain(int c, int x, int start)
   chain_start[c] = start;
 }
 
-int
-Placer::save_recompute_wire_length()
+void
+Placer::compute_demand()
 {
-  int delta = 0;
-  for (int i = 0; i < (int)recompute.size(); ++i)
+  std::fill(demand.demand.begin(), demand.demand.end(), 0.0);
+  for (int w = 0; w < (int)nets.size(); ++w)
     {
-      int w = recompute.ith(i);
-      int new_length = compute_net_length(w),
-        old_length = net_length.at(w);
-      restore_net_length.push_back(std::make_pair(w, old_length));
-      net_length[w] = new_length;
-      delta += (new_length - old_length);
+      if (!net_global[w]
+          && !net_gates[w].empty())
+        demand.add_net(net_box[w], 1.0);
     }
-  return delta;
+  demand.clear();
 }
 
 void
 Placer::restore()
 {
   move_failed = false;
+  demand.restore();
   for (const auto &p : restore_cell)
     {
-      cell_gate[p.first] = p.second;
+      set_cell_gate(p.first, p.second);
       if (p.second)
         gate_cell[p.second] = p.first;
     }
-  for (const auto &p : restore_net_length)
-    net_length[p.first] = p.second;
+  journal.restore(*this);
   for (const auto &t : restore_chain)
     {
       int e, x, start;
@@ -374,59 +1412,48 @@ Placer::restore()
 void
 Placer::discard()
 {
+  // move the committed chain positions, all erases first since the
+  // chains of a move may trade places
+  for (int i = 0; i < (int)restore_chain.size(); ++i)
+    {
+      int c, x, start;
+      std::tie(c, x, start) = restore_chain[i];
+      if (std::any_of(restore_chain.begin(), restore_chain.begin() + i,
+                      [c](const std::tuple<int, int, int> &t) { return std::get<0>(t) == c; }))
+        continue;
+      erase_column_chain(c, x, start);
+    }
+  for (int i = 0; i < (int)restore_chain.size(); ++i)
+    {
+      int c = std::get<0>(restore_chain[i]);
+      if (std::any_of(restore_chain.begin(), restore_chain.begin() + i,
+                      [c](const std::tuple<int, int, int> &t) { return std::get<0>(t) == c; }))
+        continue;
+      insert_column_chain(c);
+    }
+  
   changed_tiles.clear();
   restore_cell.clear();
   restore_chain.clear();
-  restore_net_length.clear();
-  recompute.clear();
+  journal.clear();
+  demand.clear();
 }
 
 bool
-Placer::inst_drives_global(Instance *inst, int c, int glb)
+Placer::gate_drives_global(int g, int c, int glb)
 {
-#ifndef NDEBUG
-  Location loc = chipdb->cell_location[c];
-  int t = loc.tile();
-  int x = chipdb->tile_x(t),
-    y = chipdb->tile_y(t);
-#endif
-  if (models.is_gb_io(inst)
-      && inst->find_port("GLOBAL_BUFFER_OUTPUT")->connected())
-    {
-      assert(chipdb->loc_pin_glb_num.at(loc) == glb);
-      return true;
-    }
-  
-  if (models.is_gb(inst)
-      && inst->find_port("GLOBAL_BUFFER_OUTPUT")->connected())
+  if (gate_drives_gbuf[g])
     {
-      assert(chipdb->gbufin.at(std::make_pair(x, y)) == glb);
+      assert(cell_glb[c] == glb);
       return true;
     }
   
-  if (models.is_pllX(inst))
-    {
-      Port *a = inst->find_port("PLLOUTGLOBAL");
-      if (!a)
-        a = inst->find_port("PLLOUTGLOBALA");
-      assert(a);
-      if (a->connected())
-        {
-          const auto &p2 = chipdb->cell_mfvs.at(c).at("PLLOUT_A");
-          Location glb_loc(p2.first, std::stoi(p2.second));
-          if (chipdb->loc_pin_glb_num.at(glb_loc) == glb)
-            return true;
-        }
-      
-      Port *b = inst->find_port("PLLOUTGLOBALB");
-      if (b && b->connected())
-        {
-          const auto &p2 = chipdb->cell_mfvs.at(c).at("PLLOUT_B");
-          Location glb_loc(p2.first, std::stoi(p2.second));
-          if (chipdb->loc_pin_glb_num.at(glb_loc) == glb)
-            return true;
-        }
-    }
+  if (gate_pll_global_a[g]
+      && cell_pll_glb_a[c] == glb)
+    return true;
+  if (gate_pll_global_b[g]
+      && cell_pll_glb_b[c] == glb)
+    return true;
   
   return false;
 }
@@ -440,8 +1467,7 @@ Placer::valid_global(int glb)
       int g = cell_gate[c];
       if (!g)
         continue;
-      Instance *inst = gates[g];
-      if (inst_drives_global(inst, c, glb))
+      if (gate_drives_global(g, c, glb))
         {
           if (n > 0)
             return false;
@@ -454,65 +1480,40 @@ Placer::valid_global(int glb)
 bool
 Placer::valid(int t)
 {
-  int x = chipdb->tile_x(t),
-    y = chipdb->tile_y(t);
   if (chipdb->tile_type[t] == TileType::LOGIC)
     {
-      int global_clk = 0,
-        global_sr = 0,
-        global_cen = 0;
-      int neg_clk = -1;
-      tmp_local_np.clear();
-      for (int q = 0; q < 8; q ++)
+      const PLBState &st = plb_state[t];
+      
+      // Gates must agree on CLK, SR and CEN, except that gates without
+      // one may come before (but not after) the first gate with one.
+      int local_ctrl[3];
+      int n_local_ctrl = 0;
+      for (int k = 0; k < 3; ++k)
         {
-          Location loc(t, q);
-          int cell = chipdb->loc_cell(loc);
-          int g = cell_gate[cell];
-          if (g)
+          if (st.ctrl_nets[k].empty())
+            continue;
+          if (st.ctrl_nets[k].size() > 1)
+            return false;
+          
+          unsigned without = st.occupied & ~st.ctrl_mask[k];
+          if (without >> __builtin_ctz(st.ctrl_mask[k]))
+            return false;
+          
+          int w = st.ctrl_nets[k][0].first;
+          if (!net_global[w])
             {
-              Instance *inst = gates[g];
-              
-              int clk = gate_clk[g],
-                sr = gate_sr[g],
-                cen = gate_cen[g];
-              
-              if (!global_clk)
-                global_clk = clk;
-              else if (global_clk != clk)
-                return false;
-              
-              if (!global_sr)
-                global_sr = sr;
-              else if (global_sr != sr)
-                return false;
-              
-              if (!global_cen)
-                global_cen = cen;
-              else if (global_cen != cen)
-                return false;
-              
-              int g_neg_clk = (int)inst->get_param("NEG_CLK").get_bit(0);
-              if (neg_clk == -1)
-                neg_clk = g_neg_clk;
-              else if (neg_clk != g_neg_clk)
-                return false;
-              
-              for (int np : gate_local_np[g])
-                tmp_local_np.insert(np ^ (q & 1));
+              int np = w << 1;
+              if (!PLBState::contains_ref(st.local_np, np)
+                  && std::find(local_ctrl, local_ctrl + n_local_ctrl, np) == local_ctrl + n_local_ctrl)
+                local_ctrl[n_local_ctrl++] = np;
             }
         }
       
-      if (global_clk
-          && !net_global[global_clk])
-        tmp_local_np.insert(global_clk << 1);
-      if (global_sr
-          && !net_global[global_sr])
-        tmp_local_np.insert(global_sr << 1);
-      if (global_cen
-          && !net_global[global_cen])
-        tmp_local_np.insert(global_cen << 1);
+      if (st.n_neg_clk != 0
+          && st.n_neg_clk != st.n_gates)
+        return false;
       
-      if (tmp_local_np.size() > 29)
+      if ((int)st.local_np.size() + n_local_ctrl > 29)
         return false;
     }
   else if (chipdb->tile_type[t] == TileType::IO)
@@ -547,19 +1548,17 @@ Placer::valid(int t)
           if (!contains(package.loc_pin, loc0))
             return false;
           
-          Instance *inst0 = gates[g0];
-          if (inst0->get_param("IO_STANDARD").as_string() == "SB_LVDS_INPUT")
+          if (gate_lvds_input[g0])
             {
               if (b != 3)
                 return false;
               if (g1)
                 return false;
             }
-          if (models.is_gb_io(inst0)
-              && inst0->find_port("GLOBAL_BUFFER_OUTPUT")->connected())
+          if (gate_is_gb_io[g0]
+              && gate_drives_gbuf[g0])
             {
-              int glb = chipdb->loc_pin_glb_num.at(loc0);
-              if (!valid_global(glb))
+              if (!valid_global(cell_glb[cell0]))
                 return false;
             }
         }
@@ -568,38 +1567,33 @@ Placer::valid(int t)
           if (!contains(package.loc_pin, loc1))
             return false;
           
-          Instance *inst1 = gates[g1];
-          if (inst1->get_param("IO_STANDARD").as_string() == "SB_LVDS_INPUT")
+          if (gate_lvds_input[g1])
             return false;
-          if (models.is_gb_io(inst1)
-              && inst1->find_port("GLOBAL_BUFFER_OUTPUT")->connected())
+          if (gate_is_gb_io[g1]
+              && gate_drives_gbuf[g1])
             {
-              int glb = chipdb->loc_pin_glb_num.at(loc1);
-              if (!valid_global(glb))
+              if (!valid_global(cell_glb[cell1]))
                 return false;
             }
         }
       
       if (g0 && g1)
         {
-          Instance *inst0 = gates[g0],
-            *inst1 = gates[g1];
-          if (inst0->get_param("NEG_TRIGGER").get_bit(0)
-              != inst1->get_param("NEG_TRIGGER").get_bit(0))
+          if (gate_neg_trigger[g0] != gate_neg_trigger[g1])
             return false;
           
-          Net *cen0 = inst0->find_port("CLOCK_ENABLE")->connection(),
-            *cen1 = inst1->find_port("CLOCK_ENABLE")->connection();
+          int cen0 = gate_io_cen[g0],
+            cen1 = gate_io_cen[g1];
           if (cen0 && cen1 && cen0 != cen1)
             return false;
           
-          Net *inclk0 = inst0->find_port("INPUT_CLK")->connection(),
-            *inclk1 = inst1->find_port("INPUT_CLK")->connection();
+          int inclk0 = gate_io_inclk[g0],
+            inclk1 = gate_io_inclk[g1];
           if (inclk0 && inclk1 && inclk0 != inclk1)
             return false;
           
-          Net *outclk0 = inst0->find_port("OUTPUT_CLK")->connection(),
-            *outclk1 = inst1->find_port("OUTPUT_CLK")->connection();
+          int outclk0 = gate_io_outclk[g0],
+            outclk1 = gate_io_outclk[g1];
           if (outclk0 && outclk1 && outclk0 != outclk1)
             return false;
         }
@@ -609,14 +1603,12 @@ Placer::valid(int t)
       int g2 = cell2 ? cell_gate[cell2] : 0;
       if (g2)
         {
-          if ((g0 && models.is_gb_io(gates[g0]))
-              || (g1 && models.is_gb_io(gates[g1])))
+          if ((g0 && gate_is_gb_io[g0])
+              || (g1 && gate_is_gb_io[g1]))
             return false;
           
-          Instance *inst = gates[g2];
-          int gc = lookup_or_default(gb_inst_gc, inst, gc_clk);
-          int glb = chipdb->gbufin.at(std::make_pair(x, y));
-          if (! (gc & (1 << glb)))
+          int glb = cell_glb[cell2];
+          if (! (gate_gc[g2] & (1 << glb)))
             return false;
           if (!valid_global(glb))
             return false;
@@ -625,56 +1617,23 @@ Placer::valid(int t)
       Location loc3(t, 3);
       int cell3 = chipdb->loc_cell(loc3);
       int g3 = cell3 ? cell_gate[cell3] : 0;
-      Instance *inst3 = g3 ? gates[g3] : nullptr;
-      if (inst3)
-        {
-          Port *pa = inst3->find_port("PLLOUTGLOBAL");
-          if (!pa)
-            pa = inst3->find_port("PLLOUTGLOBALA");
-          assert(pa);
-          if (pa->connected())
-            {
-              const auto &p2 = chipdb->cell_mfvs.at(cell3).at("PLLOUT_A");
-              Location glb_loc(p2.first, std::stoi(p2.second));
-              int glb = chipdb->loc_pin_glb_num.at(glb_loc);
-              if (!valid_global(glb))
-                return false;
-            }
-          
-          Port *pb = inst3->find_port("PLLOUTGLOBALB");
-          if (pb && pb->connected())
-            {
-              const auto &p2 = chipdb->cell_mfvs.at(cell3).at("PLLOUT_B");
-              Location glb_loc(p2.first, std::stoi(p2.second));
-              int glb = chipdb->loc_pin_glb_num.at(glb_loc);
-              if (!valid_global(glb))
-                return false;
-            }
-          
-          const auto &pA = chipdb->cell_mfvs.at(cell3).at("PLLOUT_A");
-          int tA = pA.first;
-          int iA = std::stoi(pA.second);
-          
-          int cA = chipdb->loc_cell(Location(tA, iA));
-          int gA = cell_gate[cA];
-          Instance *instA = gA ? gates[gA] : nullptr;
+      if (g3)
+        {
+          if (gate_pll_global_a[g3]
+              && !valid_global(cell_pll_glb_a[cell3]))
+            return false;
+          if (gate_pll_global_b[g3]
+              && !valid_global(cell_pll_glb_b[cell3]))
+            return false;
           
-          if (instA && instA->find_port("D_IN_0")->connection())
+          int gA = cell_gate[cell_pll_io_a[cell3]];
+          if (gA && gate_d_in_0[gA])
             return false;
           
-          if (inst3->instance_of()->name() == "SB_PLL40_2F_CORE"
-              || inst3->instance_of()->name() == "SB_PLL40_2_PAD"
-              || inst3->instance_of()->name() == "SB_PLL40_2F_PAD")
+          if (gate_pll_2out[g3])
             {
-              const auto &pB = chipdb->cell_mfvs.at(cell3).at("PLLOUT_B");
-              int tB = pB.first;
-              int iB = std::stoi(pB.second);
-          
-              int cB = chipdb->loc_cell(Location(tB, iB));
-              int gB = cell_gate[cB];
-              Instance *instB = gB ? gates[gB] : nullptr;
-          
-              if (instB && instB->find_port("D_IN_0")->connection())
+              int gB = cell_gate[cell_pll_io_b[cell3]];
+              if (gB && gate_d_in_0[gB])
                 return false;
             }
         }
@@ -688,7 +1647,7 @@ Placer::valid(int t)
 void
 Placer::accept_or_restore()
 {
-  int delta;
+  double delta;
 
   if (move_failed)
     goto L;
@@ -699,7 +1658,9 @@ Placer::accept_or_restore()
         goto L;
     }
   
-  delta = save_recompute_wire_length();
+  delta = journal.recompute_length(*this, net_weight);
+  if (congestion_weight > 0.0)
+    delta += congestion_weight * journal.recompute_demand(*this, demand);
   
   // check();
   
@@ -772,12 +1733,35 @@ Placer::check()
       int nt = (v.size() + 7) / 8;
       int start = chain_start[c];
       assert(start + nt - 1 <= chipdb->height - 2);
+      assert(column_chains[chain_x[c]].at(start) == (int)c);
     }
   for (int w = 1; w < (int)nets.size(); ++w) // skip 0, nullptr
-    assert(net_length[w] == compute_net_length(w));
+    {
+      assert(net_length[w] == compute_net_length(w));
+      if (!net_global[w]
+          && !net_gates[w].empty())
+        {
+          NetBox b = compute_net_box(w);
+          assert(net_box[w].xmin == b.xmin
+                 && net_box[w].xmax == b.xmax
+                 && net_box[w].ymin == b.ymin
+                 && net_box[w].ymax == b.ymax
+                 && net_box[w].n_xmin == b.n_xmin
+                 && net_box[w].n_xmax == b.n_xmax
+                 && net_box[w].n_ymin == b.n_ymin
+                 && net_box[w].n_ymax == b.n_ymax);
+        }
+    }
 }
 #endif
 
+NetBox
+Placer::compute_net_box(int w)
+{
+  return NetBox::compute(chipdb, net_gates[w],
+                         [this](int g) { return gate_cell[g]; });
+}
+
 int
 Placer::compute_net_length(int w)
 {
@@ -785,33 +1769,7 @@ Placer::compute_net_length(int w)
       || net_gates[w].empty())
     return 0;
   
-  const std::vector<int> &w_gates = net_gates[w];
-  
-  int g0 = w_gates[0];
-  int cell0 = gate_cell[g0];
-  const Location &loc0 = chipdb->cell_location[cell0];
-  int t0 = loc0.tile();
-  int x_min = chipdb->tile_x(t0),
-    x_max = chipdb->tile_x(t0),
-    y_min = chipdb->tile_y(t0),
-    y_max = chipdb->tile_y(t0);
-  
-  for (int i = 1; i < (int)w_gates.size(); ++i)
-    {
-      int g = w_gates[i];
-      int cell = gate_cell[g];
-      const Location &loc = chipdb->cell_location[cell];
-      int t = loc.tile();
-      int x = chipdb->tile_x(t),
-        y = chipdb->tile_y(t);
-      x_min = std::min(x_min, x);
-      x_max = std::max(x_max, x);
-      y_min = std::min(y_min, y);
-      y_max = std::max(y_max, y);
-    }
-  
-  assert(x_min <= x_max && y_min <= y_max);
-  return (x_max - x_min) + (y_max - y_min);
+  return compute_net_box(w).length();
 }
 
 int
@@ -823,7 +1781,8 @@ Placer::wire_length() const
   return length;
 }
 
-Placer::Placer(random_generator &rg_, DesignState &ds_)
+Placer::Placer(random_generator &rg_, DesignState &ds_,
+               const PlaceOptions &opts)
   : rg(rg_),
     ds(ds_),
     chipdb(ds.chipdb),
@@ -837,13 +1796,96 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
     placement(ds.placement),
     conf(ds.conf),
     related_tiles(chipdb->n_tiles),
+    cell_glb(chipdb->n_cells, -1),
+    cell_pll_glb_a(chipdb->n_cells, -1),
+    cell_pll_glb_b(chipdb->n_cells, -1),
+    cell_pll_io_a(chipdb->n_cells, 0),
+    cell_pll_io_b(chipdb->n_cells, 0),
     diameter(std::max(chipdb->width,
                       chipdb->height)),
     temp(10000.0),
     move_failed(false),
     changed_tiles(chipdb->n_tiles),
-    cell_gate(chipdb->n_cells, 0)
+    cell_gate(chipdb->n_cells, 0),
+    analytic(opts.analytic && !opts.eco_placement),
+    analytic_temp(opts.analytic_temp),
+    effort(opts.effort),
+    time_budget(opts.time_budget),
+    congestion_weight(opts.congestion_weight),
+    detail(opts.detail),
+    timing(opts.timing ? new TimingGraph(*opts.timing) : nullptr),
+    timing_weight(opts.timing_weight),
+    eco_placement(opts.eco_placement),
+    eco_lock(opts.eco_lock),
+    eco_temp(opts.eco_temp),
+    n_region_threads(opts.n_region_threads),
+    sweep_generation(0),
+    sweep_pending(0),
+    sweep_stop(false),
+    plogs(logs)
 {
+  if (congestion_weight > 0.0)
+    {
+      // target utilization of the span tracks in a tile
+      const double max_utilization = 0.5;
+      
+      tile_capacity.resize(chipdb->n_tiles, 0.0);
+      demand.init(chipdb, &tile_capacity);
+      for (int t = 0; t < chipdb->n_tiles; ++t)
+        {
+          int n_tracks = 0;
+          for (const auto &p : chipdb->tile_nets[t])
+            {
+              NetClass nc = chipdb->net_class[p.second];
+              if (nc == NetClass::SPAN4_H
+                  || nc == NetClass::SPAN4_V
+                  || nc == NetClass::SPAN12_H
+                  || nc == NetClass::SPAN12_V)
+                ++n_tracks;
+            }
+          tile_capacity[t] = max_utilization * n_tracks;
+        }
+    }
+  
+  int w = chipdb->width,
+    h = chipdb->height;
+  type_col_cells.resize(n_cell_types,
+                        std::vector<std::vector<int>>(w));
+  type_col_row.resize(n_cell_types,
+                      std::vector<std::vector<int>>(w, std::vector<int>(h + 1, 0)));
+  type_prefix.resize(n_cell_types,
+                     std::vector<int>((w + 1) * (h + 1), 0));
+  for (int i = 0; i < n_cell_types; ++i)
+    {
+      for (int c : chipdb->cell_type_cells[i])
+        {
+          int t = chipdb->cell_location[c].tile();
+          type_col_cells[i][chipdb->tile_x(t)].push_back(c);
+        }
+      
+      std::vector<int> &pre = type_prefix[i];
+      for (int x = 0; x < w; ++x)
+        {
+          std::vector<int> &col = type_col_cells[i][x];
+          std::sort(col.begin(), col.end(),
+                    [this](int a, int b) {
+                      return (chipdb->cell_location[a].tile()
+                              < chipdb->cell_location[b].tile());
+                    });
+          
+          std::vector<int> &row = type_col_row[i][x];
+          int j = 0;
+          for (int y = 0; y <= h; ++y)
+            {
+              while (j < (int)col.size()
+                     && chipdb->tile_y(chipdb->cell_location[col[j]].tile()) < y)
+                ++j;
+              row[y] = j;
+              pre[(x + 1)*(h + 1) + y] = pre[x*(h + 1) + y] + j;
+            }
+        }
+    }
+  
   for (const auto &p : chipdb->loc_pin_glb_num)
     {
       const Location &loc = p.first;
@@ -862,6 +1904,14 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
       global_cells[glb].push_back(c);
     }
   
+  for (const auto &p : chipdb->loc_pin_glb_num)
+    cell_glb[chipdb->loc_cell(p.first)] = p.second;
+  for (const auto &p : chipdb->gbufin)
+    {
+      int t = chipdb->tile(p.first.first, p.first.second);
+      cell_glb[chipdb->loc_cell(Location(t, 2))] = p.second;
+    }
+  
   for (int i = 1; i <= (int)chipdb->n_cells; ++i)
     {
       // FIXME
@@ -874,11 +1924,15 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
           Location glb_loca(p2a.first, std::stoi(p2a.second));
           int glba = chipdb->loc_pin_glb_num.at(glb_loca);
           global_cells[glba].push_back(i);
+          cell_pll_glb_a[i] = glba;
+          cell_pll_io_a[i] = chipdb->loc_cell(glb_loca);
           
           const auto &p2b = chipdb->cell_mfvs.at(i).at("PLLOUT_B");
           Location glb_locb(p2b.first, std::stoi(p2b.second));
           int glbb = chipdb->loc_pin_glb_num.at(glb_locb);
           global_cells[glbb].push_back(i);
+          cell_pll_glb_b[i] = glbb;
+          cell_pll_io_b[i] = chipdb->loc_cell(glb_locb);
           
           // related tiles
           std::vector<int> t_related;
@@ -924,8 +1978,9 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
   net_global.resize(n_nets);
   
   net_length.resize(n_nets);
+  net_box.resize(n_nets);
   net_gates.resize(n_nets);
-  recompute.resize(n_nets);
+  journal.resize(n_nets);
   
   std::tie(gates, gate_idx) = top->index_instances();
   n_gates = gates.size();
@@ -934,8 +1989,22 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
   gate_sr.resize(n_gates, 0);
   gate_cen.resize(n_gates, 0);
   gate_latch.resize(n_gates, 0);
+  gate_neg_clk.resize(n_gates, 0);
+  gate_lvds_input.resize(n_gates);
+  gate_neg_trigger.resize(n_gates);
+  gate_is_gb_io.resize(n_gates);
+  gate_drives_gbuf.resize(n_gates);
+  gate_d_in_0.resize(n_gates);
+  gate_pll_global_a.resize(n_gates);
+  gate_pll_global_b.resize(n_gates);
+  gate_pll_2out.resize(n_gates);
+  gate_io_cen.resize(n_gates, 0);
+  gate_io_inclk.resize(n_gates, 0);
+  gate_io_outclk.resize(n_gates, 0);
+  gate_gc.resize(n_gates, 0);
   gate_local_np.resize(n_gates);
   tmp_local_np.resize(n_nets * 2);
+  plb_state.resize(chipdb->n_tiles);
   gate_chain.resize(n_gates, -1);
   
   gate_cell.resize(n_gates);
@@ -969,6 +2038,8 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
           
           for (int j = 0; j < (int)tmp_local_np.size(); ++j)
             gate_local_np[i].push_back(tmp_local_np.ith(j));
+          
+          gate_neg_clk[i] = (int)inst->get_param("NEG_CLK").get_bit(0);
         }
       else if (models.is_io(inst))
         {
@@ -982,6 +2053,50 @@ Placer::Placer(random_generator &rg_, DesignState &ds_)
           if (n)
             net_global[net_idx.at(n)] = true;
         }
+      
+      if (models.is_ioX(inst))
+        {
+          gate_lvds_input[i] = (inst->get_param("IO_STANDARD").as_string()
+                                == "SB_LVDS_INPUT");
+          gate_neg_trigger[i] = inst->get_param("NEG_TRIGGER").get_bit(0);
+          gate_d_in_0[i] = (inst->find_port("D_IN_0")->connection() != nullptr);
+          
+          Net *cen = inst->find_port("CLOCK_ENABLE")->connection();
+          if (cen)
+            gate_io_cen[i] = net_idx.at(cen);
+          Net *inclk = inst->find_port("INPUT_CLK")->connection();
+          if (inclk)
+            gate_io_inclk[i] = net_idx.at(inclk);
+          Net *outclk = inst->find_port("OUTPUT_CLK")->connection();
+          if (outclk)
+            gate_io_outclk[i] = net_idx.at(outclk);
+        }
+      
+      if (models.is_gb_io(inst))
+        gate_is_gb_io[i] = true;
+      if ((models.is_gb_io(inst)
+           || models.is_gb(inst))
+          && inst->find_port("GLOBAL_BUFFER_OUTPUT")->connected())
+        gate_drives_gbuf[i] = true;
+      if (models.is_gb(inst))
+        gate_gc[i] = lookup_or_default(gb_inst_gc, inst, gc_clk);
+      
+      if (models.is_pllX(inst))
+        {
+          Port *a = inst->find_port("PLLOUTGLOBAL");
+          if (!a)
+            a = inst->find_port("PLLOUTGLOBALA");
+          assert(a);
+          gate_pll_global_a[i] = a->connected();
+          
+          Port *b = inst->find_port("PLLOUTGLOBALB");
+          gate_pll_global_b[i] = (b && b->connected());
+          
+          const std::string &name = inst->instance_of()->name();
+          gate_pll_2out[i] = (name == "SB_PLL40_2F_CORE"
+                              || name == "SB_PLL40_2_PAD"
+                              || name == "SB_PLL40_2F_PAD");
+        }
     }
 }
 
@@ -1012,51 +2127,147 @@ Placer::place_initial()
         }
     }
   
-  for (unsigned i = 0; i < chains.chains.size(); ++i)
+  int n_chains = chains.chains.size();
+  chain_x.resize(n_chains, -1);
+  chain_start.resize(n_chains, -1);
+  
+  auto place_chain = [this](int c, int x, int y) {
+    const auto &v = chains.chains[c];
+    for (unsigned j = 0; j < v.size(); ++j)
+      {
+        Instance *inst = v[j];
+        int g = gate_idx.at(inst);
+        Location loc(chipdb->tile(x, y + j / 8),
+                     j % 8);
+        int cell = chipdb->loc_cell(loc);
+        
+        assert(cell_gate[cell] == 0);
+        set_cell_gate(cell, g);
+        gate_cell[g] = cell;
+        chained[g] = true;
+      }
+    
+    chain_x[c] = x;
+    chain_start[c] = y;
+  };
+  
+  for (int i = 0; i < n_chains; ++i)
     {
-      const auto &v = chains.chains[i];
-      
-      int gate0 = gate_idx.at(v[0]);
+      int gate0 = gate_idx.at(chains.chains[i][0]);
       assert(gate_chain[gate0] == -1);
       gate_chain[gate0] = i;
+    }
+  
+  // ECO: a chain goes back to its first gate's previous cell if that
+  // starts a tile and the chain still fits there.  The remaining
+  // chains are stacked around them.
+  std::vector<std::vector<std::pair<int, int>>> column_seeded(chipdb->width);
+  int n_eco_gates = 0,
+    n_eco_seeded = 0;
+  if (eco_placement)
+    {
+      eco_cell.resize(n_gates, 0);
+      eco_seeded.resize(n_gates);
+      for (const auto &p : *eco_placement)
+        {
+          auto i = gate_idx.find(p.first);
+          if (i != gate_idx.end())
+            {
+              eco_cell[i->second] = p.second;
+              ++n_eco_gates;
+            }
+        }
       
-      int nt = (v.size() + 7) / 8;
+      for (int i = 0; i < n_chains; ++i)
+        {
+          int c0 = eco_cell[gate_idx.at(chains.chains[i][0])];
+          if (!c0)
+            continue;
+          
+          const Location &loc = chipdb->cell_location[c0];
+          int x = chipdb->tile_x(loc.tile()),
+            y = chipdb->tile_y(loc.tile()),
+            end = y + chain_tiles(i) - 1;
+          if (loc.pos() != 0
+              || std::find(logic_columns.begin(), logic_columns.end(), x) == logic_columns.end()
+              || y < 1
+              || end > chipdb->height - 2)
+            continue;
+          
+          for (const auto &p : column_seeded[x])
+            {
+              if (p.first <= end
+                  && y <= p.second)
+                goto not_seeded;
+            }
+          
+          place_chain(i, x, y);
+          column_seeded[x].push_back(std::make_pair(y, end));
+          for (Instance *inst : chains.chains[i])
+            {
+              int g = gate_idx.at(inst);
+              if (eco_cell[g])
+                {
+                  eco_seeded[g] = true;
+                  ++n_eco_seeded;
+                }
+              if (eco_lock)
+                locked[g] = true;
+            }
+        not_seeded:;
+        }
+    }
+  
+  int n_chains_placed = 0;
+  for (int i = 0; i < n_chains; ++i)
+    {
+      if (chain_x[i] != -1)
+        {
+          ++n_chains_placed;
+          continue;
+        }
+      
+      int nt = chain_tiles(i);
       for (unsigned k = 0; k < logic_columns.size(); ++k)
         {
-          if (logic_column_free[k] + nt - 1 <= logic_column_last[k])
+          int x = logic_columns[k];
+          int y = logic_column_free[k];
+          
+          // skip past the seeded chains
+        L:
+          for (const auto &p : column_seeded[x])
             {
-              int x = logic_columns[k];
-              int y = logic_column_free[k];
-              
-              for (unsigned j = 0; j < v.size(); ++j)
+              if (p.first <= y + nt - 1
+                  && y <= p.second)
                 {
-                  Instance *inst = v[j];
-                  int g = gate_idx.at(inst);
-                  Location loc(chipdb->tile(x, y + j / 8),
-                               j % 8);
-                  int cell = chipdb->loc_cell(loc);
-                  
-                  assert(cell_gate[cell] == 0);
-                  cell_gate[cell] = g;
-                  gate_cell[g] = cell;
-                  chained[g] = true;
+                  y = p.second + 1;
+                  goto L;
                 }
-              
-              chain_x.push_back(x);
-              chain_start.push_back(y);
-              
-              logic_column_free[k] += nt;
+            }
+          
+          if (y + nt - 1 <= logic_column_last[k])
+            {
+              place_chain(i, x, y);
+              ++n_chains_placed;
+              logic_column_free[k] = y + nt;
               goto placed_chain;
             }
         }
       fatal(fmt("failed to place: placed " 
-                << i
-                << " of " << chains.chains.size()
+                << n_chains_placed
+                << " of " << n_chains
                 << " carry chains"));
       
     placed_chain:;
     }
   
+  column_chains.resize(chipdb->width);
+  column_gaps.resize(chipdb->width);
+  for (int x : logic_columns)
+    column_gaps[x].insert(chipdb->height - 2);
+  for (int c = 0; c < (int)chains.chains.size(); ++c)
+    insert_column_chain(c);
+  
   std::vector<int> cell_type_n_placed(n_cell_types, 0);
   
   for (const auto &p : placement)
@@ -1066,7 +2277,7 @@ Placer::place_initial()
       int c = p.second;
       
       assert(cell_gate[c] == 0);
-      cell_gate[c] = g;
+      set_cell_gate(c, g);
       gate_cell[g] = c;
       
       locked[g] = true;
@@ -1078,6 +2289,40 @@ Placer::place_initial()
       assert(valid(chipdb->cell_location[c].tile()));
     }
   
+  // GBs are seeded in the constrained-first order below
+  if (eco_placement)
+    {
+      for (int g = 1; g <= n_gates; ++g)
+        {
+          int c = eco_cell[g];
+          if (!c
+              || locked[g]
+              || chained[g]
+              || cell_gate[c] != 0)
+            continue;
+          
+          CellType ct = gate_cell_type(g);
+          if (ct == CellType::GB
+              || chipdb->cell_type[c] != ct)
+            continue;
+          
+          set_cell_gate(c, g);
+          gate_cell[g] = c;
+          if (ct != CellType::WARMBOOT
+              && !valid(chipdb->cell_location[c].tile()))
+            {
+              set_cell_gate(c, 0);
+              continue;
+            }
+          
+          eco_seeded[g] = true;
+          ++n_eco_seeded;
+          ++cell_type_n_placed[cell_type_idx(ct)];
+          if (eco_lock)
+            locked[g] = true;
+        }
+    }
+  
   std::vector<std::vector<int>> cell_type_empty_cells = chipdb->cell_type_cells;
   for (int i = 0; i < n_cell_types; ++i)
     for (int j = 0; j < (int)cell_type_empty_cells[i].size();)
@@ -1102,6 +2347,10 @@ Placer::place_initial()
         continue;
       
       free_gates.push_back(i);
+      if (eco_placement
+          && eco_seeded[i])
+        continue;
+      
       CellType ct = gate_cell_type(i);
       if (ct == CellType::GB)
         {
@@ -1118,12 +2367,12 @@ Placer::place_initial()
               int c = v[j];
               
               assert(cell_gate[c] == 0);
-              cell_gate[c] = i;
+              set_cell_gate(c, i);
               gate_cell[i] = c;
               
               if (ct != CellType::WARMBOOT &&
                   !valid(chipdb->cell_location[c].tile()))
-                cell_gate[c] = 0;
+                set_cell_gate(c, 0);
               else
                 {
                   ++cell_type_n_placed[ct_idx];
@@ -1150,16 +2399,41 @@ Placer::place_initial()
       int i = p.second;
       auto &v = cell_type_empty_cells[gb_idx];
       
+      if (eco_placement
+          && eco_cell[i])
+        {
+          auto k = std::find(v.begin(), v.end(), eco_cell[i]);
+          if (k != v.end())
+            {
+              int c = *k;
+              set_cell_gate(c, i);
+              gate_cell[i] = c;
+              
+              if (!valid(chipdb->cell_location[c].tile()))
+                set_cell_gate(c, 0);
+              else
+                {
+                  ++cell_type_n_placed[gb_idx];
+                  pop(v, k - v.begin());
+                  eco_seeded[i] = true;
+                  ++n_eco_seeded;
+                  if (eco_lock)
+                    locked[i] = true;
+                  goto placed_gb;
+                }
+            }
+        }
+      
       for (unsigned j = 0; j < v.size(); ++j)
         {
           int c = v[j];
           
           assert(cell_gate[c] == 0);
-          cell_gate[c] = i;
+          set_cell_gate(c, i);
           gate_cell[i] = c;
           
           if (!valid(chipdb->cell_location[c].tile()))
-            cell_gate[c] = 0;
+            set_cell_gate(c, 0);
           else
             {
               ++cell_type_n_placed[gb_idx];
@@ -1174,6 +2448,11 @@ Placer::place_initial()
     placed_gb:;
     }
   
+  if (eco_placement)
+    *plogs << "  eco: placed " << n_eco_seeded << " of " << n_gates
+           << " gates at their previous cells (" << n_eco_gates
+           << " matched)\n";
+  
   for (int g = 1; g <= n_gates; ++g)
     {
       Instance *inst = gates[g];
@@ -1190,8 +2469,367 @@ Placer::place_initial()
         }
     }
   
+  if (analytic
+      && !place_analytic())
+    {
+      *plogs << "  analytic placement failed to legalize, using initial placement\n";
+      analytic = false;
+    }
+  
+  for (int w = 0; w < (int)nets.size(); ++w)
+    {
+      if (!net_global[w]
+          && !net_gates[w].empty())
+        net_box[w] = compute_net_box(w);
+      net_length[w] = compute_net_length(w);
+    }
+}
+
+// Solve A x = b by conjugate gradient with a Jacobi preconditioner,
+// where A has diagonal diag and off-diagonal entries -w for (j, w) in
+// adj[i].
+static void
+solve_cg(const std::vector<double> &diag,
+         const std::vector<std::vector<std::pair<int, double>>> &adj,
+         const std::vector<double> &b,
+         std::vector<double> &x)
+{
+  int n = diag.size();
+  std::vector<double> r(n), z(n), p(n), ap(n);
+  
+  auto mul = [&](const std::vector<double> &v, std::vector<double> &out) {
+    for (int i = 0; i < n; ++i)
+      {
+        double s = diag[i] * v[i];
+        for (const auto &e : adj[i])
+          s -= e.second * v[e.first];
+        out[i] = s;
+      }
+  };
+  
+  mul(x, ap);
+  double b_norm = 0.0;
+  for (int i = 0; i < n; ++i)
+    {
+      r[i] = b[i] - ap[i];
+      z[i] = r[i] / diag[i];
+      p[i] = z[i];
+      b_norm += b[i] * b[i];
+    }
+  
+  double rz = 0.0;
+  for (int i = 0; i < n; ++i)
+    rz += r[i] * z[i];
+  
+  double tol = 1e-12 * std::max(b_norm, 1.0);
+  for (int iter = 0; iter < 4 * n + 100; ++iter)
+    {
+      double rr = 0.0;
+      for (int i = 0; i < n; ++i)
+        rr += r[i] * r[i];
+      if (rr <= tol)
+        break;
+      
+      mul(p, ap);
+      double pap = 0.0;
+      for (int i = 0; i < n; ++i)
+        pap += p[i] * ap[i];
+      if (pap <= 0.0)
+        break;
+      
+      double alpha = rz / pap;
+      for (int i = 0; i < n; ++i)
+        {
+          x[i] += alpha * p[i];
+          r[i] -= alpha * ap[i];
+          z[i] = r[i] / diag[i];
+        }
+      
+      double new_rz = 0.0;
+      for (int i = 0; i < n; ++i)
+        new_rz += r[i] * z[i];
+      double beta = new_rz / rz;
+      rz = new_rz;
+      for (int i = 0; i < n; ++i)
+        p[i] = z[i] + beta * p[i];
+    }
+}
+
+void
+Placer::spread(const std::vector<int> &vars,
+               const std::vector<double> &x,
+               const std::vector<double> &y,
+               const std::vector<std::vector<int>> &cap,
+               int x0, int x1, int y0, int y1,
+               std::vector<int> &target_x,
+               std::vector<int> &target_y)
+{
+  if (vars.empty())
+    return;
+  
+  if (x0 == x1
+      && y0 == y1)
+    {
+      for (int i : vars)
+        {
+          target_x[i] = x0;
+          target_y[i] = y0;
+        }
+      return;
+    }
+  
+  bool split_x = (x1 - x0 >= y1 - y0);
+  int m = split_x ? (x0 + x1) / 2 : (y0 + y1) / 2;
+  
+  int c1 = 0, c2 = 0;
+  for (int i = x0; i <= x1; ++i)
+    for (int j = y0; j <= y1; ++j)
+      {
+        if ((split_x ? i : j) <= m)
+          c1 += cap[i][j];
+        else
+          c2 += cap[i][j];
+      }
+  
+  int n = vars.size();
+  assert(n <= c1 + c2);
+  int n1 = (int)std::lround((double)n * c1 / (c1 + c2));
+  n1 = std::max(n1, n - c2);
+  n1 = std::min(n1, c1);
+  
+  const std::vector<double> &coord = split_x ? x : y;
+  std::vector<int> sorted = vars;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [&coord](int a, int b) { return coord[a] < coord[b]; });
+  
+  std::vector<int> lo(sorted.begin(), sorted.begin() + n1),
+    hi(sorted.begin() + n1, sorted.end());
+  if (split_x)
+    {
+      spread(lo, x, y, cap, x0, m, y0, y1, target_x, target_y);
+      spread(hi, x, y, cap, m + 1, x1, y0, y1, target_x, target_y);
+    }
+  else
+    {
+      spread(lo, x, y, cap, x0, x1, y0, m, target_x, target_y);
+      spread(hi, x, y, cap, x0, x1, m + 1, y1, target_x, target_y);
+    }
+}
+
+bool
+Placer::place_analytic()
+{
+  std::vector<int> var_gate;
+  BasedVector<int, 1> gate_var(n_gates, -1);
+  for (int g : free_gates)
+    {
+      if (gate_cell_type(g) == CellType::LOGIC)
+        {
+          gate_var[g] = var_gate.size();
+          var_gate.push_back(g);
+        }
+    }
+  int n_gate_vars = var_gate.size();
+  if (n_gate_vars == 0)
+    return true;
+  
+  auto gate_x = [this](int g) {
+    return (double)chipdb->tile_x(chipdb->cell_location[gate_cell[g]].tile());
+  };
+  auto gate_y = [this](int g) {
+    return (double)chipdb->tile_y(chipdb->cell_location[gate_cell[g]].tile());
+  };
+  
+  // connections between variables, (variable, fixed gate) connections
+  std::vector<std::vector<std::pair<int, double>>> adj(n_gate_vars);
+  std::vector<std::vector<std::pair<int, double>>> fixed(n_gate_vars);
+  int n_vars = n_gate_vars;
+  
+  auto connect_vars = [&](int a, int b, double wt) {
+    adj[a].push_back(std::make_pair(b, wt));
+    adj[b].push_back(std::make_pair(a, wt));
+  };
+  auto connect = [&](int a, int b, double wt) {
+    // a is a variable, b a gate
+    if (gate_var[b] >= 0)
+      connect_vars(a, gate_var[b], wt);
+    else
+      fixed[a].push_back(std::make_pair(b, wt));
+  };
+  
   for (int w = 0; w < (int)nets.size(); ++w)
-    net_length[w] = compute_net_length(w);
+    {
+      if (net_global[w])
+        continue;
+      
+      std::vector<int> ng = net_gates[w];
+      std::sort(ng.begin(), ng.end());
+      ng.erase(std::unique(ng.begin(), ng.end()), ng.end());
+      int p = ng.size();
+      if (p < 2)
+        continue;
+      
+      if (std::none_of(ng.begin(), ng.end(),
+                       [&gate_var](int g) { return gate_var[g] >= 0; }))
+        continue;
+      
+      if (p <= 3)
+        {
+          double wt = 1.0 / (p - 1);
+          for (int i = 0; i < p; ++i)
+            for (int j = i + 1; j < p; ++j)
+              {
+                if (gate_var[ng[i]] >= 0)
+                  connect(gate_var[ng[i]], ng[j], wt);
+                else if (gate_var[ng[j]] >= 0)
+                  connect(gate_var[ng[j]], ng[i], wt);
+              }
+        }
+      else
+        {
+          int s = n_vars++;
+          adj.emplace_back();
+          fixed.emplace_back();
+          double wt = (double)p / (p - 1);
+          for (int g : ng)
+            connect(s, g, wt);
+        }
+    }
+  
+  double cx = 0.5 * (chipdb->width - 1),
+    cy = 0.5 * (chipdb->height - 1);
+  std::vector<double> x(n_vars, cx), y(n_vars, cy);
+  
+  // free LC capacity per tile
+  std::vector<std::vector<int>> cap(chipdb->width,
+                                    std::vector<int>(chipdb->height, 0));
+  for (int c : chipdb->cell_type_cells[cell_type_idx(CellType::LOGIC)])
+    {
+      int g = cell_gate[c];
+      if (!g || gate_var[g] >= 0)
+        {
+          int t = chipdb->cell_location[c].tile();
+          ++cap[chipdb->tile_x(t)][chipdb->tile_y(t)];
+        }
+    }
+  
+  std::vector<int> gate_vars(n_gate_vars);
+  for (int i = 0; i < n_gate_vars; ++i)
+    gate_vars[i] = i;
+  std::vector<int> target_x(n_gate_vars, 0),
+    target_y(n_gate_vars, 0);
+  
+  const int n_rounds = 6;
+  for (int round = 0; round < n_rounds; ++round)
+    {
+      std::vector<double> diag(n_vars, 0.0),
+        bx(n_vars, 0.0),
+        by(n_vars, 0.0);
+      for (int i = 0; i < n_vars; ++i)
+        {
+          for (const auto &e : adj[i])
+            diag[i] += e.second;
+          for (const auto &e : fixed[i])
+            {
+              diag[i] += e.second;
+              bx[i] += e.second * gate_x(e.first);
+              by[i] += e.second * gate_y(e.first);
+            }
+          
+          // weak pull to the center keeps A positive definite
+          const double eps = 1e-3;
+          diag[i] += eps;
+          bx[i] += eps * cx;
+          by[i] += eps * cy;
+        }
+      
+      if (round > 0)
+        {
+          double alpha = 0.2 * round;
+          for (int i = 0; i < n_gate_vars; ++i)
+            {
+              diag[i] += alpha;
+              bx[i] += alpha * target_x[i];
+              by[i] += alpha * target_y[i];
+            }
+        }
+      
+      solve_cg(diag, adj, bx, x);
+      solve_cg(diag, adj, by, y);
+      
+      spread(gate_vars, x, y, cap,
+             0, chipdb->width - 1, 0, chipdb->height - 1,
+             target_x, target_y);
+    }
+  
+  // legalize, nearest target first
+  std::vector<int> old_cell(n_gate_vars);
+  for (int i = 0; i < n_gate_vars; ++i)
+    {
+      int g = var_gate[i];
+      old_cell[i] = gate_cell[g];
+      set_cell_gate(gate_cell[g], 0);
+    }
+  
+  std::vector<int> order = gate_vars;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) {
+                     double da = std::abs(x[a] - target_x[a]) + std::abs(y[a] - target_y[a]),
+                       db = std::abs(x[b] - target_x[b]) + std::abs(y[b] - target_y[b]);
+                     return da < db;
+                   });
+  
+  int max_r = chipdb->width + chipdb->height;
+  for (int k = 0; k < n_gate_vars; ++k)
+    {
+      int i = order[k];
+      int g = var_gate[i];
+      for (int r = 0; r <= max_r; ++r)
+        for (int dx = -r; dx <= r; ++dx)
+          {
+            int ady = r - std::abs(dx);
+            for (int dy = -ady; dy <= ady; dy += std::max(1, 2 * ady))
+              {
+                int tx = target_x[i] + dx,
+                  ty = target_y[i] + dy;
+                if (tx < 0 || tx >= chipdb->width
+                    || ty < 0 || ty >= chipdb->height)
+                  continue;
+                
+                int t = chipdb->tile(tx, ty);
+                if (chipdb->tile_type[t] != TileType::LOGIC)
+                  continue;
+                
+                for (int q = 0; q < 8; ++q)
+                  {
+                    int c = chipdb->loc_cell(Location(t, q));
+                    if (cell_gate[c])
+                      continue;
+                    
+                    set_cell_gate(c, g);
+                    gate_cell[g] = c;
+                    if (valid(t))
+                      goto placed;
+                    set_cell_gate(c, 0);
+                  }
+              }
+          }
+      
+      // restore the initial placement
+      for (int j = 0; j < k; ++j)
+        set_cell_gate(gate_cell[var_gate[order[j]]], 0);
+      for (int j = 0; j < n_gate_vars; ++j)
+        {
+          int g2 = var_gate[j];
+          set_cell_gate(old_cell[j], g2);
+          gate_cell[g2] = old_cell[j];
+        }
+      return false;
+      
+    placed:;
+    }
+  
+  return true;
 }
 
 void
@@ -1774,27 +3412,90 @@ Placer::configure()
 }
 
 void
-Placer::place()
+Placer::anneal()
 {
   place_initial();
   // check();
   
-  *logs << "  initial wire length = " << wire_length() << "\n";
+  *plogs << "  initial wire length = " << wire_length() << "\n";
+  if (congestion_weight > 0.0)
+    {
+      compute_demand();
+      *plogs << "  initial congestion = " << congestion() << "\n";
+    }
+  if (timing)
+    update_timing();
+  
+  if (analytic)
+    {
+      temp = analytic_temp;
+      diameter = std::max(3, diameter / 4);
+    }
+  else if (eco_placement)
+    {
+      temp = eco_temp;
+      diameter = std::max(3, diameter / 4);
+    }
   
   int n_no_progress = 0;
   double avg_wire_length = wire_length();
   
-  for (int iter=1;; iter++)
+  int n_sweeps = 15,
+    max_no_progress = 5;
+  double cbrt_n = std::cbrt((double)free_gates.size());
+  if (effort == PlaceEffort::FAST)
+    {
+      n_sweeps = std::max(1, (int)std::lround(0.5 * cbrt_n));
+      max_no_progress = 2;
+    }
+  else if (effort == PlaceEffort::HIGH)
+    n_sweeps = std::max(15, (int)std::lround(3.0 * cbrt_n));
+  
+  auto start = std::chrono::steady_clock::now();
+  const double final_temp = 1e-3;
+  int iter = 1;
+  
+  // strips at least two columns wide
+  n_region_threads = std::min(n_region_threads, chipdb->width / 2);
+  if (n_region_threads > 1)
+    {
+      for (int g : free_gates)
+        {
+          if (gate_cell_type(g) == CellType::LOGIC)
+            logic_free_gates.push_back(g);
+          else
+            other_free_gates.push_back(g);
+        }
+      
+      gate_owner.resize(n_gates, -1);
+      gate_cell_snapshot.resize(n_gates, 0);
+      net_owner.resize(nets.size(), -2);
+      for (int k = 0; k < n_region_threads; ++k)
+        workers.push_back(std::unique_ptr<PlaceWorker>(new PlaceWorker(*this, k, rg.random())));
+      start_workers();
+    }
+  
+  for (;; iter++)
     {
       n_move = n_accept = 0;
       improved = false;
 
       if (iter % 50 == 0)
-        *logs << "  at iteration #" << iter << ": temp = " << temp << ", wire length = " << wire_length() << "\n";
+        *plogs << "  at iteration #" << iter << ": temp = " << temp << ", wire length = " << wire_length() << "\n";
+      if (timing
+          && iter % 10 == 0)
+        update_timing();
       
-      for (int m = 0; m < 15; ++m)
+      for (int m = 0; m < n_sweeps; ++m)
         {
-          for (int g : free_gates)
+          if (!workers.empty())
+            {
+              parallel_sweep(iter * n_sweeps + m);
+              if (congestion_weight > 0.0)
+                compute_demand();
+            }
+          
+          for (int g : (workers.empty() ? free_gates : other_free_gates))
             {
               int new_cell = gate_random_cell(g);             
               
@@ -1832,10 +3533,24 @@ Placer::place()
       else
         ++n_no_progress;
       
-      if (temp <= 1e-3
-          && n_no_progress >= 5)
+      if (temp <= final_temp
+          && n_no_progress >= max_no_progress)
         break;
       
+      double temp0 = temp;
+      double elapsed = 0.0;
+      if (time_budget > 0.0)
+        {
+          std::chrono::duration<double> d2 = std::chrono::steady_clock::now() - start;
+          elapsed = d2.count();
+          if (elapsed >= time_budget)
+            {
+              *plogs << "  placement time budget exhausted at iteration #" << iter
+                     << ", temp = " << temp << "\n";
+              break;
+            }
+        }
+      
       double Raccept = (double)n_accept / (double)n_move;
 #if 0
       std::cout << "Raccept " << Raccept
@@ -1877,10 +3592,223 @@ Placer::place()
                 temp *= 0.8;
             }
         }
+      
+      // cool at least fast enough to reach final_temp in the
+      // iterations left at the current time per iteration
+      if (time_budget > 0.0
+          && elapsed > 0.0
+          && temp0 > final_temp)
+        {
+          double iters_left = std::max(1.0, (time_budget - elapsed) * iter / elapsed);
+          double min_cool = std::pow(final_temp / temp0, 1.0 / iters_left);
+          temp = std::min(temp, temp0 * min_cool);
+        }
+    }
+  
+  if (!workers.empty())
+    stop_workers();
+  
+  if (detail)
+    {
+      std::chrono::duration<double> d2 = std::chrono::steady_clock::now() - start;
+      if (time_budget > 0.0
+          && d2.count() >= time_budget)
+        *plogs << "  placement time budget exhausted, skipping detailed placement\n";
+      else
+        detail_place();
+    }
+  
+  std::chrono::duration<double> anneal_time = std::chrono::steady_clock::now() - start;
+  *plogs << "  final wire length = " << wire_length()
+         << " after " << iter << " iterations, "
+         << Fixed(anneal_time.count(), 2) << "s\n";
+  if (congestion_weight > 0.0)
+    *plogs << "  final congestion = " << congestion() << "\n";
+}
+
+bool
+Placer::optimal_region_move(int g)
+{
+  std::vector<int> xs, ys;
+  for (int w : gate_nets[g])
+    {
+      if (net_global[w])
+        continue;
+      
+      bool first = true;
+      int xmin = 0, xmax = 0, ymin = 0, ymax = 0;
+      for (int g2 : net_gates[w])
+        {
+          if (g2 == g)
+            continue;
+          int t = chipdb->cell_location[gate_cell[g2]].tile();
+          int x = chipdb->tile_x(t),
+            y = chipdb->tile_y(t);
+          if (first)
+            {
+              xmin = xmax = x;
+              ymin = ymax = y;
+              first = false;
+            }
+          else
+            {
+              xmin = std::min(xmin, x);
+              xmax = std::max(xmax, x);
+              ymin = std::min(ymin, y);
+              ymax = std::max(ymax, y);
+            }
+        }
+      if (first)
+        continue;
+      
+      xs.push_back(xmin);
+      xs.push_back(xmax);
+      ys.push_back(ymin);
+      ys.push_back(ymax);
+    }
+  if (xs.empty())
+    return false;
+  
+  std::sort(xs.begin(), xs.end());
+  std::sort(ys.begin(), ys.end());
+  int n = xs.size();
+  
+  int t = chipdb->cell_location[gate_cell[g]].tile();
+  int x = chipdb->tile_x(t),
+    y = chipdb->tile_y(t);
+  int target_x = std::min(std::max(x, xs[n/2 - 1]), xs[n/2]),
+    target_y = std::min(std::max(y, ys[n/2 - 1]), ys[n/2]);
+  if (target_x == x
+      && target_y == y)
+    return false;
+  
+  for (int r = 0; r <= 1; ++r)
+    for (int dx = -r; dx <= r; ++dx)
+      for (int dy = -r; dy <= r; ++dy)
+        {
+          int new_x = target_x + dx,
+            new_y = target_y + dy;
+          if (new_x < 0 || new_x >= chipdb->width
+              || new_y < 0 || new_y >= chipdb->height
+              || std::max(std::abs(dx), std::abs(dy)) != r)
+            continue;
+          
+          int new_t = chipdb->tile(new_x, new_y);
+          if (chipdb->tile_type[new_t] != TileType::LOGIC
+              || new_t == t)
+            continue;
+          
+          for (int q = 0; q < 8; ++q)
+            {
+              int new_cell = chipdb->loc_cell(Location(new_t, q));
+              int new_g = cell_gate[new_cell];
+              if (new_g
+                  && (chained[new_g] || locked[new_g]))
+                continue;
+              
+              move_gate(g, new_cell);
+              accept_or_restore();
+              if (gate_cell[g] == new_cell)
+                return true;
+            }
+        }
+  return false;
+}
+
+void
+Placer::window_swaps(int window)
+{
+  std::vector<int> window_gates;
+  
+  for (int x0 = 0; x0 < chipdb->width; x0 += window)
+    for (int y0 = 0; y0 < chipdb->height; y0 += window)
+      {
+        window_gates.clear();
+        for (int x = x0; x < std::min(x0 + window, chipdb->width); ++x)
+          for (int y = y0; y < std::min(y0 + window, chipdb->height); ++y)
+            {
+              int t = chipdb->tile(x, y);
+              if (chipdb->tile_type[t] != TileType::LOGIC)
+                continue;
+              
+              for (int q = 0; q < 8; ++q)
+                {
+                  int g = cell_gate[chipdb->loc_cell(Location(t, q))];
+                  if (!g
+                      || chained[g]
+                      || locked[g])
+                    continue;
+                  
+                  window_gates.push_back(g);
+                }
+            }
+        
+        for (int i = 0; i < (int)window_gates.size(); ++i)
+          for (int j = i + 1; j < (int)window_gates.size(); ++j)
+            {
+              int a = window_gates[i],
+                b = window_gates[j];
+              if (chipdb->cell_location[gate_cell[a]].tile()
+                  == chipdb->cell_location[gate_cell[b]].tile())
+                continue;
+              
+              move_gate(a, gate_cell[b]);
+              accept_or_restore();
+            }
+      }
+}
+
+void
+Placer::detail_place()
+{
+  double saved_temp = temp;
+  temp = 0.0;
+  
+  int initial_length = wire_length();
+  for (int pass = 0; pass < 5; ++pass)
+    {
+      int pass_length = wire_length();
+      
+      for (int g : free_gates)
+        {
+          if (gate_cell_type(g) == CellType::LOGIC)
+            optimal_region_move(g);
+        }
+      window_swaps(3);
+      
+      if (wire_length() >= pass_length)
+        break;
     }
   
-  *logs << "  final wire length = " << wire_length() << "\n";
+  *plogs << "  detailed placement: wire length " << initial_length
+         << " -> " << wire_length() << "\n";
+  
+  temp = saved_temp;
+}
+
+void
+Placer::update_timing()
+{
+  std::vector<int> inst_cell(timing->insts.size());
+  for (int i = 0; i < (int)timing->insts.size(); ++i)
+    inst_cell[i] = gate_cell[gate_idx.at(timing->insts[i])];
+  timing->estimate_wire_delays(inst_cell);
+  timing->analyze();
   
+  net_weight.assign(nets.size(), 1.0);
+  for (int w = 1; w < (int)nets.size(); ++w) // skip 0, nullptr
+    {
+      auto i = timing->net_idx.find(nets[w]);
+      if (i == timing->net_idx.end())
+        continue;
+      double crit = timing->net_crit[i->second];
+      net_weight[w] = 1.0 + timing_weight * crit * crit;
+    }
+}
+
+void
+Placer::finish()
+{
   configure();
   
 #if 0
@@ -2005,15 +3933,61 @@ Placer::place()
 }
 
 void
-place(random_generator &rg, DesignState &ds)
+Placer::place()
 {
-  Placer placer(rg, ds);
-  
-  clock_t start = clock();
-  placer.place();
-  clock_t end = clock();
+  anneal();
+  finish();
+}
+
+void
+place(random_generator &rg, DesignState &ds, const PlaceOptions &opts)
+{
+  auto start = std::chrono::steady_clock::now();
+  if (opts.n_threads <= 1)
+    {
+      Placer placer(rg, ds, opts);
+      placer.place();
+    }
+  else
+    {
+      // Independent annealers with seeds drawn from rg.  Only the
+      // winner configures, so the threads share ds read-only.
+      int n = opts.n_threads;
+      std::vector<random_generator> rgs;
+      for (int k = 0; k < n; ++k)
+        rgs.push_back(random_generator(rg.random()));
+      
+      std::vector<std::unique_ptr<Placer>> placers(n);
+      std::vector<std::unique_ptr<std::ostringstream>> placer_logs(n);
+      std::vector<std::thread> threads;
+      for (int k = 0; k < n; ++k)
+        {
+          placer_logs[k].reset(new std::ostringstream);
+          threads.push_back(std::thread([k, &opts, &rgs, &ds, &placers, &placer_logs]() {
+                placers[k].reset(new Placer(rgs[k], ds, opts));
+                placers[k]->plogs = placer_logs[k].get();
+                placers[k]->anneal();
+              }));
+        }
+      for (auto &t : threads)
+        t.join();
+      
+      int best = 0;
+      for (int k = 0; k < n; ++k)
+        {
+          *logs << "  placer " << k << ": final wire length = "
+                << placers[k]->final_wire_length() << "\n";
+          if (placers[k]->final_wire_length()
+              < placers[best]->final_wire_length())
+            best = k;
+        }
+      *logs << "  using placer " << best << "\n"
+            << placer_logs[best]->str();
+      
+      placers[best]->plogs = logs;
+      placers[best]->finish();
+    }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
   
-  *logs << "  place time "
-        << std::fixed << std::setprecision(2)
-        << (double)(end - start) / (double)CLOCKS_PER_SEC << "s\n";
+  *logs << "  place time " << Fixed(elapsed.count(), 2) << "s\n";
 }
@@ -28,7 +28,76 @@ class Constraints;
 class CarryChains;
 class IdLess;
 class DesignState;
+class TimingGraph;
 
-extern void place(random_generator &rg, DesignState &ds);
+enum class PlaceEffort : int {
+  FAST, NORMAL, HIGH,
+};
+
+class PlaceOptions
+{
+public:
+  // independent annealers with derived seeds, keeping the one with
+  // the lowest wire length
+  int n_threads;
+  
+  // worker threads per annealer, each moving LCs within a strip of
+  // the chip
+  int n_region_threads;
+  
+  // start annealing from a quadratic placement of the LCs at
+  // analytic_temp instead of from the greedy placement
+  bool analytic;
+  double analytic_temp;
+  
+  // moves per temperature: fast and high scale with the cube root of
+  // the number of movable gates, normal is 15 sweeps
+  PlaceEffort effort;
+  
+  // wall-clock seconds for annealing, cooling faster to finish in
+  // time; 0 for no limit
+  double time_budget;
+  
+  // weight of the RUDY routing congestion overflow in the annealing
+  // cost, 0 to anneal on wire length only
+  double congestion_weight;
+  
+  // greedy detailed placement after annealing, if time_budget is not
+  // exhausted
+  bool detail;
+  
+  // if not null, wire length is weighted by 1 + timing_weight *
+  // criticality^2 of each net, from analyses during annealing
+  TimingGraph *timing;
+  double timing_weight;
+  
+  // ECO placement: if not null, the previous cells of unchanged
+  // instances.  They are placed there (and kept there with eco_lock)
+  // before the remaining gates are placed greedily, and annealing
+  // starts at eco_temp.  Overrides analytic.
+  const std::map<Instance *, int, IdLess> *eco_placement;
+  bool eco_lock;
+  double eco_temp;
+  
+public:
+  PlaceOptions()
+    : n_threads(1),
+      n_region_threads(1),
+      analytic(false),
+      analytic_temp(10.0),
+      effort(PlaceEffort::NORMAL),
+      time_budget(0.0),
+      congestion_weight(0.0),
+      detail(false),
+      timing(nullptr),
+      timing_weight(4.0),
+      eco_placement(nullptr),
+      eco_lock(false),
+      eco_temp(1.0)
+  {}
+};
+
+extern void place(random_generator &rg, DesignState &ds,
+                  const PlaceOptions &opts);
 
 #endif
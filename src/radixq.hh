@@ -0,0 +1,140 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef PNR_RADIXQ_HH
+#define PNR_RADIXQ_HH
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <climits>
+#include <cassert>
+
+// Radix heap of (value, key) pairs with non-negative integer keys.
+// Elements are bucketed by the highest bit in which their key differs
+// from the last key popped, so push and pop are amortized O(1) for
+// monotone use.  Keys at or below the last popped key go to bucket 0,
+// a binary heap, so they still pop in (key, value) order, at heap
+// cost; restart re-buckets the queue below such keys.
+class RadixQ
+{
+  static const int n_buckets = sizeof(unsigned) * CHAR_BIT + 1;
+  
+  std::vector<std::pair<int, int>> bucket[n_buckets];
+  unsigned last;
+  size_t n;
+  
+  // max-heap order, so bucket[0].front() is the least
+  static bool greater(const std::pair<int, int> &lhs,
+                      const std::pair<int, int> &rhs)
+  {
+    return (lhs.second > rhs.second
+            || (lhs.second == rhs.second
+                && lhs.first > rhs.first));
+  }
+  
+  int bucket_idx(int key) const
+  {
+    assert(key >= 0);
+    unsigned k = (unsigned)key;
+    if (k <= last)
+      return 0;
+    return n_buckets - 1 - __builtin_clz(k ^ last);
+  }
+  
+  void insert(const std::pair<int, int> &x)
+  {
+    int i = bucket_idx(x.second);
+    bucket[i].push_back(x);
+    if (i == 0)
+      std::push_heap(bucket[0].begin(), bucket[0].end(), greater);
+  }
+  
+  void normalize()
+  {
+    assert(n > 0);
+    if (!bucket[0].empty())
+      return;
+    
+    int i = 1;
+    while (bucket[i].empty())
+      ++i;
+    
+    std::vector<std::pair<int, int>> &b = bucket[i];
+    unsigned new_last = (unsigned)b[0].second;
+    for (const auto &x : b)
+      new_last = std::min(new_last, (unsigned)x.second);
+    last = new_last;
+    
+    for (const auto &x : b)
+      {
+        assert(bucket_idx(x.second) < i);
+        insert(x);
+      }
+    b.clear();
+  }
+  
+public:
+  RadixQ() : last(0), n(0) {}
+  
+  size_t size() const { return n; }
+  bool empty() const { return n == 0; }
+  void clear()
+  {
+    for (int i = 0; i < n_buckets; ++i)
+      bucket[i].clear();
+    last = 0;
+    n = 0;
+  }
+  
+  // Re-bucket the elements as if the last key popped were 0, for a
+  // run of pushes below the last popped key.  O(n).
+  void restart()
+  {
+    std::vector<std::pair<int, int>> v;
+    for (int i = 0; i < n_buckets; ++i)
+      {
+        v.insert(v.end(), bucket[i].begin(), bucket[i].end());
+        bucket[i].clear();
+      }
+    last = 0;
+    for (const auto &x : v)
+      insert(x);
+  }
+  
+  void push(const std::pair<int, int> &x)
+  {
+    insert(x);
+    ++n;
+  }
+  
+  std::pair<int, int> pop()
+  {
+    normalize();
+    std::pop_heap(bucket[0].begin(), bucket[0].end(), greater);
+    std::pair<int, int> x = bucket[0].back();
+    bucket[0].pop_back();
+    --n;
+    return x;
+  }
+  
+  const std::pair<int, int> &top()
+  {
+    normalize();
+    return bucket[0].front();
+  }
+};
+
+#endif
@@ -22,7 +22,11 @@
 #include "bitvector.hh"
 #include "ullmanset.hh"
 #include "priorityq.hh"
+#include "radixq.hh"
+#include "indexedq.hh"
 #include "designstate.hh"
+#include "route.hh"
+#include "timing.hh"
 
 #include <cassert>
 #include <ostream>
@@ -32,7 +36,11 @@
 #include <set>
 #include <map>
 #include <vector>
-#include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 class Router;
 
@@ -50,6 +58,109 @@ public:
   }
 };
 
+// The frontier queue holds (cn, cost + estimate) pairs.  The default
+// is a binary heap with stale entries; -DPNR_ROUTE_INDEXEDQ selects a
+// binary heap with decrease-key, and -DPNR_ROUTE_RADIXQ a radix heap,
+// restarted by inject since the new segments have cost 0.
+#if defined(PNR_ROUTE_RADIXQ)
+typedef RadixQ FrontierQ;
+#elif defined(PNR_ROUTE_INDEXEDQ)
+typedef IndexedQ FrontierQ;
+#else
+typedef PriorityQ<std::pair<int, int>, Comp> FrontierQ;
+#endif
+
+class Box
+{
+public:
+  int xmin, xmax, ymin, ymax;
+  
+public:
+  Box() : xmin(0), xmax(-1), ymin(0), ymax(-1) {}
+  Box(int xmin_, int xmax_, int ymin_, int ymax_)
+    : xmin(xmin_), xmax(xmax_), ymin(ymin_), ymax(ymax_)
+  {}
+  
+  bool contains(const Box &b) const
+  {
+    return (xmin <= b.xmin
+            && b.xmax <= xmax
+            && ymin <= b.ymin
+            && b.ymax <= ymax);
+  }
+  bool intersects(const Box &b) const
+  {
+    return (b.xmax >= xmin
+            && b.xmin <= xmax
+            && b.ymax >= ymin
+            && b.ymin <= ymax);
+  }
+  void extend(const Box &b)
+  {
+    xmin = std::min(xmin, b.xmin);
+    xmax = std::max(xmax, b.xmax);
+    ymin = std::min(ymin, b.ymin);
+    ymax = std::max(ymax, b.ymax);
+  }
+};
+
+// State of the search for one net.  Each routing thread has its own.
+class Search
+{
+public:
+  // cnets not contained in region are off limits
+  Box region;
+  // cnets not meeting window are skipped
+  Box window;
+  // bbox of unrouted targets
+  Box targets;
+  
+  UllmanSet unrouted;
+  
+  // cnets on the net's current route and those kept by partial_ripup
+  UllmanSet tree;
+  UllmanSet kept;
+  
+  UllmanSet visited;
+  
+  UllmanSet frontier;
+  // cn, cost[cn] + estimate[cn]
+  FrontierQ frontierq;
+  
+  std::vector<int> backptr;
+  std::vector<int> cost;
+  std::vector<int> estimate;
+  
+  // criticality of the net being routed
+  double crit;
+  
+  // change to Router::n_shared not yet merged
+  int n_shared_delta;
+  
+  // stats for the current pass
+  int n_rerouted;
+  long n_expanded;
+  
+public:
+  Search(int n_cnets, const Box &region_)
+    : region(region_),
+      unrouted(n_cnets),
+      tree(n_cnets),
+      kept(n_cnets),
+      visited(n_cnets),
+      frontier(n_cnets),
+      backptr(n_cnets),
+      cost(n_cnets),
+      estimate(n_cnets, 0),
+      crit(0.0),
+      n_shared_delta(0),
+      n_rerouted(0),
+      n_expanded(0)
+  {}
+};
+
+static const int max_cnet_cost = 1000000;
+
 class Router
 {
   const ChipDB *chipdb;
@@ -59,51 +170,106 @@ class Router
   std::vector<Net *> &cnet_net;
   Configuration &conf;
   
-  BitVector cnet_global,
-    cnet_local;
-  std::vector<std::vector<int>> cnet_outs;
-  
   std::map<std::string, std::pair<std::string, bool>> ram_gate_chip;
   std::map<std::string, std::string> pll_gate_chip;
   
   std::vector<std::vector<int>> cnet_tiles;
-  // cnet_bbox
-  std::vector<int> cnet_xmin,
-    cnet_xmax,
-    cnet_ymin,
-    cnet_ymax;
+  std::vector<Box> cnet_bbox;
+  Box chip;
   
   int n_nets;  // to route
   std::vector<int> net_source;
   std::vector<std::vector<int>> net_targets;
   std::vector<Net *> net_net;
   
+  // Short connections: for each net, (target, mid) for the paths from
+  // the source to a target through at most one other cnet mid, -1 for
+  // a direct connection.  Such targets are connected without a search
+  // when the cnets on the path are free, which covers most connections
+  // within a tile or to a neighbouring one.
+  std::vector<std::vector<std::pair<int, int>>> net_short_paths;
+  
   int max_passes;
   int passes;
   
+  double pres_fac;
+  double pres_fac_mult;
+  double hist_fac;
+  int stall_passes;
+  int final_pass_penalty;
+  
+  // A* lookahead: the larger of ceil(astar_scale * d), where d is the
+  // tile distance from a cnet's bbox to the bbox of the unrouted
+  // targets, and the chipdb's lookahead table if present.  A single
+  // hop can close at most max_cnet_span tiles, and the table is a
+  // lower bound, so astar_weight = 1 keeps the estimate admissible.
+  // The table is looked up at the unrouted targets if there are at
+  // most max_lookahead_targets of them, otherwise in
+  // lookahead_envelope, the minimum of the table over the offsets at
+  // least as far in both x and y, at the point of the targets' bbox
+  // nearest the cnet.
+  double astar_weight;
+  double astar_scale;
+  int max_cnet_span;
+  static const int max_lookahead_targets = 8;
+  std::vector<std::vector<int>> lookahead_envelope;
+  
+  // Each net's search is restricted to cnets whose bbox meets the bbox
+  // of the net's terminals grown by net_margin[net] tiles.  The margin
+  // starts at bbox_margin and doubles when the net fails to route.
+  int bbox_margin;
+  std::vector<int> net_margin;
+  
+  // With more than one thread, each pass first routes the nets that
+  // fit in one of the regions from a recursive bisection of the chip,
+  // the regions concurrently, and then the remaining nets serially.
+  // Searches in a region only use cnets contained in the region, so
+  // the threads never touch the same cnets.
+  int n_threads;
+  std::vector<Search> searches;
+  
   int n_shared;
   std::vector<int> demand;
   std::vector<int> historical_demand;
   std::vector<std::vector<std::pair<int, int>>> net_route;
   
-  // per net
-  int current_net;
-  UllmanSet unrouted;
+  // Timing: each net's criticality, capped at max_crit so congestion
+  // is never ignored, and (target cnet, timing connection) for its
+  // targets.
+  TimingGraph *timing;
+  std::vector<double> net_crit;
+  std::vector<std::vector<std::pair<int, int>>> net_target_conns;
+  std::vector<int> route_depth;
+  void update_net_crit();
+  void update_timing();
   
-  UllmanSet visited;
+  // ECO routing: nets whose previous route misses some targets,
+  // routed in the first pass
+  const std::map<std::string, std::vector<std::pair<int, int>>> *eco_routes;
+  std::map<std::string, std::vector<std::pair<int, int>>> *routes_out;
+  std::vector<char> eco_incomplete;
+  void load_eco_routes();
   
-  UllmanSet frontier;
-  // cn, cost[cn]
-  PriorityQ<std::pair<int, int>, Comp> frontierq;
+  int cnet_estimate(const Search &s, int cn) const;
+  Box net_window(int net) const;
+  void start(Search &s, int net);
+  void inject(Search &s, int net, int first);
+  int pop(Search &s);
+  void visit(Search &s, int cn);
+  void ripup(Search &s, int net);
+  void partial_ripup(Search &s, int net);
+  void traceback(Search &s, int net, int target);
   
-  std::vector<int> backptr;
-  std::vector<int> cost;
-  
-  void start(int net);
-  int pop();
-  void visit(int cn);
-  void ripup(int net);
-  void traceback(int net, int target);
+  bool needs_route(int net) const;
+  void compute_short_paths();
+  void route_short(Search &s, int net);
+  bool route_net(Search &s, int net);
+  void partition(const Box &region,
+                 const std::vector<int> &nets,
+                 int depth,
+                 std::vector<std::pair<Box, std::vector<int>>> &leaves,
+                 std::vector<int> &rest) const;
+  void route_pass();
   
   int port_cnet(Instance *inst, Port *p);
 
@@ -112,7 +278,7 @@ class Router
 #endif
   
 public:
-  Router(DesignState &ds, int max_passes_v);
+  Router(DesignState &ds, const RouteOptions &opts);
   
   void route();
 };
@@ -279,69 +445,37 @@ Router::check()
 }
 #endif
 
-Router::Router(DesignState &ds, int max_passes_v)
+Router::Router(DesignState &ds, const RouteOptions &opts)
   : chipdb(ds.chipdb),
     d(ds.d),
     models(ds.models),
     placement(ds.placement),
     cnet_net(ds.cnet_net),
     conf(ds.conf),
-    cnet_global(chipdb->n_nets),
-    cnet_local(chipdb->n_nets),
-    cnet_outs(chipdb->n_nets),
     cnet_tiles(chipdb->n_nets),
-    cnet_xmin(chipdb->n_nets),
-    cnet_xmax(chipdb->n_nets),
-    cnet_ymin(chipdb->n_nets),
-    cnet_ymax(chipdb->n_nets),
+    cnet_bbox(chipdb->n_nets),
+    chip(0, chipdb->width - 1, 0, chipdb->height - 1),
     n_nets(0),
-    max_passes(max_passes_v),
+    max_passes(opts.max_passes),
+    pres_fac(opts.pres_fac),
+    pres_fac_mult(opts.pres_fac_mult),
+    hist_fac(opts.hist_fac),
+    stall_passes(opts.stall_passes),
+    final_pass_penalty(opts.final_pass_penalty),
+    astar_weight(opts.astar_weight),
+    astar_scale(0.0),
+    max_cnet_span(0),
+    bbox_margin(opts.bbox_margin),
+    n_threads(std::max(1, opts.n_threads)),
     n_shared(0),
     demand(chipdb->n_nets, 0),
     historical_demand(chipdb->n_nets, 0),
-    unrouted(chipdb->n_nets),
-    visited(chipdb->n_nets),
-    frontier(chipdb->n_nets),
-    backptr(chipdb->n_nets),
-    cost(chipdb->n_nets)
+    timing(opts.timing),
+    eco_routes(opts.eco_routes),
+    routes_out(opts.routes_out)
 {
   cnet_net = std::vector<Net *>(chipdb->n_nets, nullptr);
   
-  for (int t = 0; t < chipdb->n_tiles; ++t)
-    {
-      for (const auto &p : chipdb->tile_nets[t])
-        {
-          if (is_prefix("local_", p.first))
-            {
-              if (!cnet_local[p.second])
-                {
-                  cnet_local[p.second] = true;
-                  break;
-                }
-            }
-          else if (is_prefix("glb_netwk_", p.first))
-            {
-              if (!cnet_global[p.second])
-                {
-                  cnet_global[p.second] = true;
-                  break;
-                }
-            }
-        }
-    }
-  
-  for (int i = 0; i < chipdb->n_nets; ++i)
-    {
-      for (int s : chipdb->in_switches[i])
-        {
-          assert(contains_key(chipdb->switches[s].in_val, i));
-          int j = chipdb->switches[s].out;
-          assert(j != i);
-          
-          cnet_outs[i].push_back(j);
-        }
-    }
-  
   for (int i = 0; i <= 7; ++i)
     extend(ram_gate_chip,
            fmt("RDATA[" << i << "]"),
@@ -437,144 +571,512 @@ Router::Router(DesignState &ds, int max_passes_v)
     {
       assert(!cnet_tiles[i].empty());
       int t0 = cnet_tiles[i][0];
-      int xmin, xmax, ymin, ymax;
-      xmin = xmax = chipdb->tile_x(t0);
-      ymin = ymax = chipdb->tile_y(t0);
+      Box &b = cnet_bbox[i];
+      b.xmin = b.xmax = chipdb->tile_x(t0);
+      b.ymin = b.ymax = chipdb->tile_y(t0);
       for (int j = 1; j < (int)cnet_tiles[i].size(); ++j)
         {
           int t = cnet_tiles[i][j];
-          xmin = std::min(xmin, chipdb->tile_x(t));
-          xmax = std::max(xmax, chipdb->tile_x(t));
-          ymin = std::min(ymin, chipdb->tile_y(t));
-          ymax = std::max(ymax, chipdb->tile_y(t));
+          b.xmin = std::min(b.xmin, chipdb->tile_x(t));
+          b.xmax = std::max(b.xmax, chipdb->tile_x(t));
+          b.ymin = std::min(b.ymin, chipdb->tile_y(t));
+          b.ymax = std::max(b.ymax, chipdb->tile_y(t));
         }
-      cnet_xmin[i] = xmin;
-      cnet_xmax[i] = xmax;
-      cnet_ymin[i] = ymin;
-      cnet_ymax[i] = ymax;
     }
+  
+  // only cnets entered by a hop count, which leaves out the global
+  // networks
+  for (int j : chipdb->edge_net)
+    max_cnet_span = std::max(max_cnet_span,
+                             ((cnet_bbox[j].xmax - cnet_bbox[j].xmin)
+                              + (cnet_bbox[j].ymax - cnet_bbox[j].ymin)));
+  if (max_cnet_span > 0)
+    astar_scale = astar_weight / (double)max_cnet_span;
+  
+  if (!chipdb->lookahead.empty())
+    {
+      int w = chipdb->width,
+        h = chipdb->height;
+      lookahead_envelope.resize(n_net_classes, std::vector<int>(w * h));
+      for (int c = 0; c < n_net_classes; ++c)
+        {
+          NetClass nc = static_cast<NetClass>(c);
+          std::vector<int> &env = lookahead_envelope[c];
+          for (int ay = h - 1; ay >= 0; --ay)
+            for (int ax = w - 1; ax >= 0; --ax)
+              {
+                int e = std::min(std::min(chipdb->lookahead_hops(nc, ax, ay),
+                                          chipdb->lookahead_hops(nc, -ax, ay)),
+                                 std::min(chipdb->lookahead_hops(nc, ax, -ay),
+                                          chipdb->lookahead_hops(nc, -ax, -ay)));
+                if (ax + 1 < w)
+                  e = std::min(e, env[ay * w + ax + 1]);
+                if (ay + 1 < h)
+                  e = std::min(e, env[(ay + 1) * w + ax]);
+                env[ay * w + ax] = e;
+              }
+        }
+    }
+  
+  searches.reserve(n_threads);
+  for (int i = 0; i < n_threads; ++i)
+    searches.emplace_back(chipdb->n_nets, chip);
 }
 
+// Keep the branches of the previous routes that lead from each net's
+// source to its targets over existing switches, without passing
+// through another net's source.
 void
-Router::start(int net)
+Router::load_eco_routes()
 {
-  visited.clear();
+  BitVector is_source(chipdb->n_nets);
+  for (int i = 0; i < n_nets; ++i)
+    is_source[net_source[i]] = true;
   
-  frontier.clear();
-  frontierq.clear();
+  eco_incomplete.resize(n_nets, 0);
+  
+  int n_kept = 0,
+    n_partial = 0;
+  std::map<int, int> parent;
+  std::set<int> kept;
+  std::vector<int> path;
+  for (int i = 0; i < n_nets; ++i)
+    {
+      auto r = eco_routes->find(net_net[i]->name());
+      if (r == eco_routes->end())
+        continue;
+      
+      parent.clear();
+      for (const auto &p : r->second)
+        {
+          int in = p.first,
+            out = p.second;
+          if (is_source[out]
+              || contains(chipdb->net_global, out)
+              || contains_key(parent, out))
+            goto discard;
+          
+          for (int e = chipdb->net_edge_begin[in]; e < chipdb->net_edge_begin[in + 1]; ++e)
+            {
+              if (chipdb->edge_net[e] == out)
+                goto found;
+            }
+          goto discard;
+        found:
+          extend(parent, out, in);
+        }
+      
+      {
+        int source = net_source[i];
+        int n_reached = 0;
+        kept.clear();
+        for (int t : net_targets[i])
+          {
+            path.clear();
+            int cn = t;
+            while (cn != source
+                   && !contains(kept, cn))
+              {
+                auto j = parent.find(cn);
+                if (j == parent.end()
+                    || path.size() > parent.size())  // cycle
+                  goto unreached;
+                path.push_back(cn);
+                cn = j->second;
+              }
+            kept.insert(path.begin(), path.end());
+            ++n_reached;
+          unreached:;
+          }
+        
+        if (!n_reached)
+          continue;
+        
+        for (const auto &p : r->second)
+          {
+            int cn = p.second;
+            if (!contains(kept, cn))
+              continue;
+            
+            if (demand[cn] == 1)
+              ++n_shared;
+            ++demand[cn];
+            net_route[i].push_back(p);
+          }
+        
+        if (n_reached == (int)net_targets[i].size())
+          ++n_kept;
+        else
+          {
+            eco_incomplete[i] = 1;
+            ++n_partial;
+          }
+      }
+      
+    discard:;
+    }
+  
+  *logs << "  eco: kept " << n_kept << " routes, " << n_partial
+        << " partially, of " << n_nets << " nets\n";
+}
+
+// Set the wire delays of the routed connections from the number of
+// cnets on their routes, re-analyze and update the net criticalities.
+void
+Router::update_timing()
+{
+  std::vector<int> parent(chipdb->n_nets, -1);
+  std::vector<int> path;
+  for (int i = 0; i < n_nets; ++i)
+    {
+      if (net_route[i].empty())
+        continue;
+      
+      for (const auto &p : net_route[i])
+        parent[p.second] = p.first;
+      
+      route_depth[net_source[i]] = 0;
+      for (const auto &p : net_target_conns[i])
+        {
+          int k = p.second;
+          if (timing->net_global[timing->conn_net[k]])
+            continue;
+          
+          // walk up to the source or a cnet of known depth
+          int cn = p.first;
+          path.clear();
+          while (route_depth[cn] < 0
+                 && parent[cn] >= 0)
+            {
+              path.push_back(cn);
+              cn = parent[cn];
+            }
+          if (route_depth[cn] < 0)
+            continue;  // unrouted
+          int depth = route_depth[cn];
+          for (int j = (int)path.size() - 1; j >= 0; --j)
+            route_depth[path[j]] = ++depth;
+          
+          timing->conn_delay[k] = (timing->dm.wire_base
+                                   + timing->dm.wire_per_hop * route_depth[p.first]);
+        }
+      
+      for (const auto &p : net_route[i])
+        {
+          parent[p.second] = -1;
+          route_depth[p.second] = -1;
+        }
+      route_depth[net_source[i]] = -1;
+    }
+  
+  timing->analyze();
+  update_net_crit();
+}
+
+void
+Router::update_net_crit()
+{
+  const double max_crit = 0.99;
+  
+  net_crit.assign(n_nets, 0.0);
+  for (int i = 0; i < n_nets; ++i)
+    for (const auto &p : net_target_conns[i])
+      net_crit[i] = std::max(net_crit[i],
+                             std::min(max_crit, timing->conn_crit[p.second]));
+}
+
+int
+Router::cnet_estimate(const Search &s, int cn) const
+{
+  const Box &b = cnet_bbox[cn];
+  int dx = std::max(0, std::max(s.targets.xmin - b.xmax,
+                                b.xmin - s.targets.xmax)),
+    dy = std::max(0, std::max(s.targets.ymin - b.ymax,
+                              b.ymin - s.targets.ymax));
+  // guard against rounding up an exact multiple of max_cnet_span
+  int est = (int)std::ceil(astar_scale * (double)(dx + dy) - 1e-9);
+  
+  if (!lookahead_envelope.empty())
+    {
+      NetClass nc = chipdb->net_class[cn];
+      int hops;
+      if ((int)s.unrouted.size() <= max_lookahead_targets)
+        {
+          hops = -1;
+          for (int i = 0; i < (int)s.unrouted.size(); ++i)
+            {
+              const Box &tb = cnet_bbox[s.unrouted.ith(i)];
+              int h = chipdb->lookahead_hops(nc,
+                                             tb.xmin - b.xmin,
+                                             tb.ymin - b.ymin);
+              if (hops < 0
+                  || h < hops)
+                hops = h;
+            }
+        }
+      else
+        {
+          int tx = std::min(std::max(b.xmin, s.targets.xmin), s.targets.xmax),
+            ty = std::min(std::max(b.ymin, s.targets.ymin), s.targets.ymax);
+          hops = lookahead_envelope[net_class_idx(nc)][std::abs(ty - b.ymin) * chipdb->width
+                                                       + std::abs(tx - b.xmin)];
+        }
+      est = std::max(est, (int)(astar_weight * (double)hops));
+    }
+  
+  return est;
+}
+
+Box
+Router::net_window(int net) const
+{
+  Box w = cnet_bbox[net_source[net]];
+  for (int t : net_targets[net])
+    w.extend(cnet_bbox[t]);
+  
+  int margin = net_margin[net];
+  return Box(std::max(0, w.xmin - margin),
+             std::min(chipdb->width - 1, w.xmax + margin),
+             std::max(0, w.ymin - margin),
+             std::min(chipdb->height - 1, w.ymax + margin));
+}
+
+void
+Router::start(Search &s, int net)
+{
+  s.visited.clear();
+  
+  s.frontier.clear();
+  s.frontierq.clear();
+  
+  assert(!s.unrouted.empty());
+  s.targets = cnet_bbox[s.unrouted.ith(0)];
+  for (int i = 1; i < (int)s.unrouted.size(); ++i)
+    s.targets.extend(cnet_bbox[s.unrouted.ith(i)]);
+  
+  s.crit = net_crit.empty() ? 0.0 : net_crit[net];
   
   int source = net_source[net];
-  cost[source] = 0;
-  backptr[source] = -1;
-  visit(source);
+  s.cost[source] = 0;
+  s.backptr[source] = -1;
+  visit(s, source);
   
   for (const auto &p : net_route[net])
     {
-      frontier.erase(p.second);
+      s.frontier.erase(p.second);
+      
+      s.cost[p.second] = 0;
+      s.backptr[p.second] = -1;
+      visit(s, p.second);
+    }
+}
+
+// Grow the search from the route segments net_route[net][first...]
+// just added by traceback.  The rest of the wavefront is kept: its
+// costs are distances to the smaller tree and are lowered as the
+// search from the new segments reaches them.
+void
+Router::inject(Search &s, int net, int first)
+{
+  s.targets = cnet_bbox[s.unrouted.ith(0)];
+  for (int i = 1; i < (int)s.unrouted.size(); ++i)
+    s.targets.extend(cnet_bbox[s.unrouted.ith(i)]);
+  
+  for (int i = first; i < (int)net_route[net].size(); ++i)
+    {
+      int cn = net_route[net][i].second;
+      s.frontier.erase(cn);
       
-      cost[p.second] = 0;
-      backptr[p.second] = -1;
-      visit(p.second);
+      s.cost[cn] = 0;
+      s.backptr[cn] = -1;
     }
+#ifdef PNR_ROUTE_RADIXQ
+  s.frontierq.restart();
+#endif
+  for (int i = first; i < (int)net_route[net].size(); ++i)
+    visit(s, net_route[net][i].second);
 }
 
 void
-Router::visit(int cn)
+Router::visit(Search &s, int cn)
 {
-  assert(!frontier.contains(cn));
-  visited.extend(cn);
+  assert(!s.frontier.contains(cn));
+  // cn may be revisited after inject
+  s.visited.insert(cn);
+  ++s.n_expanded;
   
-  for (int cn2 : cnet_outs[cn])
+  for (int e = chipdb->net_edge_begin[cn]; e < chipdb->net_edge_begin[cn + 1]; ++e)
     {
-      if (visited.contains(cn2))
+      int cn2 = chipdb->edge_net[e];
+      const Box &b2 = cnet_bbox[cn2];
+      if (!s.window.intersects(b2)
+          || !s.region.contains(b2))
         continue;
       
-      int cn2_cost = 1;  // base
+      int cn2_cost = chipdb->net_base_cost[cn2];
       if (passes == max_passes)
         {
           if (demand[cn2])
-            cn2_cost = 1000000;
+            cn2_cost = final_pass_penalty;
         }
       else // if (passes > 1)
         {
-          cn2_cost += historical_demand[cn2];
-          cn2_cost *= (1 + 3 * demand[cn2]);
+          double c = ((cn2_cost + hist_fac * historical_demand[cn2])
+                      * (1.0 + pres_fac * demand[cn2]));
+          if (s.crit > 0.0)
+            c = s.crit * cn2_cost + (1.0 - s.crit) * c;
+          cn2_cost = (int)std::min(c, (double)max_cnet_cost);
         }
       
-      int new_cost = cost[cn] + cn2_cost;
+      int new_cost = s.cost[cn] + cn2_cost;
       
-      if (frontier.contains(cn2))
+      if (s.frontier.contains(cn2))
         {
-          if (new_cost < cost[cn2])
+          if (new_cost < s.cost[cn2])
             {
 #if 0
               std::cout << "update cn " << cn2
-                        << " old_cost " << cost[cn2]
+                        << " old_cost " << s.cost[cn2]
                         << " new_cost " << new_cost << "\n";
 #endif
-              cost[cn2] = new_cost;
-              backptr[cn2] = cn;
-              frontierq.push(std::make_pair(cn2, new_cost));
+              s.cost[cn2] = new_cost;
+              s.backptr[cn2] = cn;
+              s.frontierq.push(std::make_pair(cn2, new_cost + s.estimate[cn2]));
+            }
+        }
+      else if (s.visited.contains(cn2))
+        {
+          // reopen
+          if (new_cost < s.cost[cn2])
+            {
+              s.cost[cn2] = new_cost;
+              s.backptr[cn2] = cn;
+              s.frontier.insert(cn2);
+              s.frontierq.push(std::make_pair(cn2, new_cost + s.estimate[cn2]));
             }
         }
       else
         {
-          cost[cn2] = new_cost;
-          backptr[cn2] = cn;
+          s.cost[cn2] = new_cost;
+          s.backptr[cn2] = cn;
+          s.estimate[cn2] = cnet_estimate(s, cn2);
 #if 0
           std::cout << "add cn " << cn2
                     << " cost " << new_cost << "\n";
 #endif
-          frontier.insert(cn2);
-          frontierq.push(std::make_pair(cn2, new_cost));
+          s.frontier.insert(cn2);
+          s.frontierq.push(std::make_pair(cn2, new_cost + s.estimate[cn2]));
         }
     }
 }
 
 int
-Router::pop()
+Router::pop(Search &s)
 {
  L:
-  assert(!frontierq.empty());
-  int cn, cn_cost;
-  std::tie(cn, cn_cost) = frontierq.pop();
-  if (!frontier.contains(cn))
+  assert(!s.frontierq.empty());
+  int cn, cn_key;
+  std::tie(cn, cn_key) = s.frontierq.pop();
+  if (!s.frontier.contains(cn)
+      || cn_key != s.cost[cn] + s.estimate[cn])
     goto L;
   
   // *logs << "pop " << cn << "\n";
-  assert(cn_cost == cost[cn]);
-  assert(frontierq.empty()
-         || cn_cost <= frontierq.top().second);
+  assert(s.frontierq.empty()
+         || cn_key <= s.frontierq.top().second);
   
-  frontier.erase(cn);
+  s.frontier.erase(cn);
   
   return cn;
 }
 
 void
-Router::ripup(int net)
+Router::ripup(Search &s, int net)
 {
   for (const auto &p : net_route[net])
     {
       int cn = p.second;
       --demand[cn];
       if (demand[cn] == 1)
-        --n_shared;
+        --s.n_shared_delta;
     }
   net_route[net].clear();
 }
 
+// Rip up the branches of the route leading to targets whose path from
+// the source crosses a shared cnet, keeping the paths to the other
+// targets.  The targets cut off are added to unrouted.
+void
+Router::partial_ripup(Search &s, int net)
+{
+  int source = net_source[net];
+  
+  // backptr holds the route tree until start
+  s.tree.clear();
+  for (const auto &p : net_route[net])
+    {
+      s.tree.insert(p.second);
+      s.backptr[p.second] = p.first;
+    }
+  
+  s.kept.clear();
+  for (int t : net_targets[net])
+    {
+      if (!s.tree.contains(t))
+        {
+          s.unrouted.insert(t);
+          continue;
+        }
+      
+      bool shared = false;
+      for (int cn = t; cn != source; cn = s.backptr[cn])
+        {
+          if (demand[cn] > 1)
+            {
+              shared = true;
+              break;
+            }
+        }
+      if (shared)
+        {
+          s.unrouted.insert(t);
+          continue;
+        }
+      
+      for (int cn = t;
+           cn != source && !s.kept.contains(cn);
+           cn = s.backptr[cn])
+        s.kept.insert(cn);
+    }
+  
+  std::vector<std::pair<int, int>> &route = net_route[net];
+  int k = 0;
+  for (const auto &p : route)
+    {
+      int cn = p.second;
+      if (s.kept.contains(cn))
+        route[k++] = p;
+      else
+        {
+          --demand[cn];
+          if (demand[cn] == 1)
+            --s.n_shared_delta;
+        }
+    }
+  route.resize(k);
+}
+
 void
-Router::traceback(int net, int target)
+Router::traceback(Search &s, int net, int target)
 {
   int cn = target;
   while (cn >= 0)
     {
-      int prev = backptr[cn];
+      int prev = s.backptr[cn];
       if (prev >= 0)
         {
           if (demand[cn] == 1)
-            ++n_shared;
+            ++s.n_shared_delta;
           ++demand[cn];
           net_route[net].push_back(std::make_pair(prev, cn));
         }
@@ -582,6 +1084,300 @@ Router::traceback(int net, int target)
     }
 }
 
+bool
+Router::needs_route(int net) const
+{
+  if (net_route[net].empty()
+      || (!eco_incomplete.empty()
+          && eco_incomplete[net]))
+    return true;
+  
+  for (const auto &p : net_route[net])
+    {
+      if (demand[p.second] > 1)
+        return true;
+    }
+  return false;
+}
+
+void
+Router::compute_short_paths()
+{
+  net_short_paths.resize(n_nets);
+  
+  UllmanSet targets(chipdb->n_nets);
+  for (int n = 0; n < n_nets; ++n)
+    {
+      targets.clear();
+      for (int t : net_targets[n])
+        targets.insert(t);
+      
+      std::vector<std::pair<int, int>> &paths = net_short_paths[n];
+      int source = net_source[n];
+      for (int e = chipdb->net_edge_begin[source]; e < chipdb->net_edge_begin[source + 1]; ++e)
+        {
+          int mid = chipdb->edge_net[e];
+          if (targets.contains(mid))
+            paths.push_back(std::make_pair(mid, -1));
+          
+          for (int e2 = chipdb->net_edge_begin[mid]; e2 < chipdb->net_edge_begin[mid + 1]; ++e2)
+            {
+              int t = chipdb->edge_net[e2];
+              if (targets.contains(t))
+                paths.push_back(std::make_pair(t, mid));
+            }
+        }
+      
+      // direct connections first
+      std::stable_partition(paths.begin(), paths.end(),
+                            [](const std::pair<int, int> &p) {
+                              return p.second < 0;
+                            });
+    }
+}
+
+void
+Router::route_short(Search &s, int net)
+{
+  int source = net_source[net];
+  for (const auto &p : net_short_paths[net])
+    {
+      int t = p.first,
+        mid = p.second;
+      if (!s.unrouted.contains(t)
+          || demand[t] > 0)
+        continue;
+      
+      if (mid < 0)
+        {
+          ++demand[t];
+          net_route[net].push_back(std::make_pair(source, t));
+        }
+      else
+        {
+          if (demand[mid] > 0
+              || !s.region.contains(cnet_bbox[mid]))
+            continue;
+          
+          ++demand[mid];
+          ++demand[t];
+          net_route[net].push_back(std::make_pair(source, mid));
+          net_route[net].push_back(std::make_pair(mid, t));
+        }
+      s.unrouted.erase(t);
+    }
+}
+
+bool
+Router::route_net(Search &s, int net)
+{
+  ++s.n_rerouted;
+  
+  s.unrouted.clear();
+  if (net_route[net].empty())
+    {
+      for (int i : net_targets[net])
+        // not extend, e.g., lutff_global/clk
+        s.unrouted.insert(i);
+    }
+  else
+    {
+      // reroute only the congested branches
+      partial_ripup(s, net);
+      if (s.unrouted.empty())
+        return true;
+    }
+  
+  route_short(s, net);
+  if (s.unrouted.empty())
+    return true;
+  
+  s.window = net_window(net);
+  
+ L:
+  // *logs << "start:";
+  
+  start(s, net);
+  while (!s.frontier.empty())
+    {
+      int cn = pop(s);
+      
+      if (s.unrouted.contains(cn))
+        {
+          s.unrouted.erase(cn);
+          int first = net_route[net].size();
+          traceback(s, net, cn);
+          
+          if (s.unrouted.empty())
+            return true;
+          inject(s, net, first);
+        }
+      else
+        visit(s, cn);
+    }
+  
+  if (!s.window.contains(s.region))
+    {
+      // keep the partial route and search again in a larger window
+      net_margin[net] = std::max(1, 2 * net_margin[net]);
+      s.window = net_window(net);
+      goto L;
+    }
+  
+  return false;
+}
+
+void
+Router::partition(const Box &region,
+                  const std::vector<int> &nets,
+                  int depth,
+                  std::vector<std::pair<Box, std::vector<int>>> &leaves,
+                  std::vector<int> &rest) const
+{
+  bool cut_x = (region.xmax - region.xmin >= region.ymax - region.ymin);
+  if (depth == 0
+      || nets.empty()
+      || (cut_x
+          ? region.xmin == region.xmax
+          : region.ymin == region.ymax))
+    {
+      leaves.push_back(std::make_pair(region, nets));
+      return;
+    }
+  
+  // a net must fit in a side together with its current route
+  std::vector<Box> net_box;
+  std::vector<int> centers;
+  for (int n : nets)
+    {
+      Box b = net_window(n);
+      for (const auto &p : net_route[n])
+        b.extend(cnet_bbox[p.second]);
+      net_box.push_back(b);
+      centers.push_back(cut_x
+                        ? b.xmin + b.xmax
+                        : b.ymin + b.ymax);
+    }
+  
+  // cut at the median net center
+  std::nth_element(centers.begin(),
+                   centers.begin() + centers.size() / 2,
+                   centers.end());
+  int c = centers[centers.size() / 2] / 2;
+  Box lo = region,
+    hi = region;
+  if (cut_x)
+    {
+      c = std::min(std::max(c, region.xmin), region.xmax - 1);
+      lo.xmax = c;
+      hi.xmin = c + 1;
+    }
+  else
+    {
+      c = std::min(std::max(c, region.ymin), region.ymax - 1);
+      lo.ymax = c;
+      hi.ymin = c + 1;
+    }
+  
+  std::vector<int> lo_nets,
+    hi_nets;
+  for (unsigned i = 0; i < nets.size(); ++i)
+    {
+      if (lo.contains(net_box[i]))
+        lo_nets.push_back(nets[i]);
+      else if (hi.contains(net_box[i]))
+        hi_nets.push_back(nets[i]);
+      else
+        rest.push_back(nets[i]);
+    }
+  
+  partition(lo, lo_nets, depth - 1, leaves, rest);
+  partition(hi, hi_nets, depth - 1, leaves, rest);
+}
+
+void
+Router::route_pass()
+{
+  std::vector<int> serial_nets;
+  
+  if (n_threads == 1)
+    {
+      for (int n = 0; n < n_nets; ++n)
+        serial_nets.push_back(n);
+    }
+  else
+    {
+      std::vector<int> all_nets;
+      for (int n = 0; n < n_nets; ++n)
+        all_nets.push_back(n);
+      
+      int depth = 0;
+      while ((1 << depth) < n_threads)
+        ++depth;
+      
+      std::vector<std::pair<Box, std::vector<int>>> leaves;
+      partition(chip, all_nets, depth, leaves, serial_nets);
+      
+      // The result doesn't depend on which thread routes which
+      // region, so regions are handed out first-come first-served.
+      std::vector<std::vector<int>> leaf_failed(leaves.size());
+      std::atomic<int> next_leaf(0);
+      std::vector<std::thread> threads;
+      for (int i = 0; i < n_threads; ++i)
+        threads.push_back(std::thread([this, i, &leaves, &leaf_failed, &next_leaf]() {
+              Search &s = searches[i];
+              for (;;)
+                {
+                  int k = next_leaf++;
+                  if (k >= (int)leaves.size())
+                    break;
+                  s.region = leaves[k].first;
+                  for (int n : leaves[k].second)
+                    {
+                      if (needs_route(n)
+                          && !route_net(s, n))
+                        {
+                          ripup(s, n);
+                          leaf_failed[k].push_back(n);
+                        }
+                    }
+                }
+              s.region = chip;
+            }));
+      for (auto &t : threads)
+        t.join();
+      
+      for (const auto &v : leaf_failed)
+        serial_nets.insert(serial_nets.end(), v.begin(), v.end());
+      std::sort(serial_nets.begin(), serial_nets.end());
+    }
+  
+  Search &s = searches[0];
+  assert(s.region.contains(chip));
+  for (int n : serial_nets)
+    {
+      if (!needs_route(n))
+        continue;
+      
+      if (!route_net(s, n))
+        {
+          *logs << net_source[n] << " ->";
+          for (int t : net_targets[n])
+            *logs << " " << t;
+          *logs << "\n";
+          assert(false);
+        }
+      
+      // check();
+    }
+  
+  for (Search &s2 : searches)
+    {
+      n_shared += s2.n_shared_delta;
+      s2.n_shared_delta = 0;
+    }
+}
+
 void
 Router::route()
 {
@@ -624,6 +1420,7 @@ Router::route()
       
       int source = -1;
       std::vector<int> targets;
+      std::vector<std::pair<int, int>> target_conns;
       
       // *logs << n->name() << "\n";
       
@@ -663,6 +1460,12 @@ Router::route()
             {
               assert(p2->is_input());
               targets.push_back(cn);
+              if (timing)
+                {
+                  auto i = timing->port_conn.find(p2);
+                  if (i != timing->port_conn.end())
+                    target_conns.push_back(std::make_pair(cn, i->second));
+                }
             }
         }
       
@@ -683,79 +1486,75 @@ Router::route()
           net_source.push_back(source);
           net_targets.push_back(std::move(targets));
           net_net.push_back(n);
+          net_target_conns.push_back(std::move(target_conns));
         }
     }
   
   net_route.resize(n_nets);
+  net_margin.resize(n_nets, bbox_margin);
+  compute_short_paths();
+  
+  if (eco_routes)
+    load_eco_routes();
+  
+  if (timing)
+    {
+      timing->estimate_wire_delays(timing->placement_cells(placement));
+      timing->analyze();
+      route_depth.resize(chipdb->n_nets, -1);
+      update_net_crit();
+    }
   
+  int best_shared = -1,
+    n_stalled = 0;
   for (passes = 1; passes <= max_passes; ++passes)
     {
-      for (int n = 0; n < n_nets; ++n)
+      auto pass_start = std::chrono::steady_clock::now();
+      for (Search &s : searches)
         {
-          current_net = n;
-          
-          const auto &targets = net_targets[n];
-          
-          if (passes > 1)
-            {
-              assert(net_route[n].size() > 0);
-              for (const auto &p : net_route[n])
-                {
-                  if (demand[p.second] > 1)
-                    goto M;
-                }
-              continue;
-            }
-          
-        M:
-          unrouted.clear();
-          for (int i : targets)
-            // not extend, e.g., lutff_global/clk
-            unrouted.insert(i);
-          
-          ripup(n);
-          
-        L:
-          // *logs << "start:";
-          
-          start(n);
-          while (!frontier.empty())
-            {
-              int cn = pop();
-              
-              if (unrouted.contains(cn))
-                {
-                  unrouted.erase(cn);
-                  traceback(n, cn);
-                  
-                  if (unrouted.empty())
-                    break;
-                  else
-                    goto L;
-                }
-              else
-                visit(cn);
-            }
-          
-          if (!unrouted.empty())
-            {
-              *logs << net_source[n] << " ->";
-              for (int t : targets)
-                *logs << " " << t;
-              *logs << "\n";
-            }
-          
-          assert(unrouted.empty());
-          
-          // *logs << "\n";
-          
-          // check();
+          s.n_rerouted = 0;
+          s.n_expanded = 0;
+        }
+      
+      route_pass();
+      eco_incomplete.clear();
+      if (timing)
+        update_timing();
+      
+      int n_rerouted = 0;
+      long n_expanded = 0;
+      for (const Search &s : searches)
+        {
+          n_rerouted += s.n_rerouted;
+          n_expanded += s.n_expanded;
         }
+      std::chrono::duration<double> pass_time
+        = std::chrono::steady_clock::now() - pass_start;
       
-      *logs << "  pass " << passes << ", " << n_shared << " shared.\n";
+      *logs << "  pass " << passes << ", " << n_shared << " shared, "
+            << n_rerouted << " nets rerouted, "
+            << n_expanded << " cnets expanded, "
+            << Fixed(pass_time.count(), 2) << "s.\n";
       if (!n_shared)
         break;
       
+      pres_fac *= pres_fac_mult;
+      if (best_shared < 0
+          || n_shared < best_shared)
+        {
+          best_shared = n_shared;
+          n_stalled = 0;
+        }
+      else if (stall_passes > 0
+               && ++n_stalled >= stall_passes)
+        {
+          pres_fac *= 2.0;
+          n_stalled = 0;
+          *logs << "  no progress in " << stall_passes
+                << " passes, present congestion factor now "
+                << pres_fac << "\n";
+        }
+      
       if (passes > 1)
         {
           for (int i = 0; i < chipdb->n_nets; ++i)
@@ -822,6 +1621,13 @@ Router::route()
   if (n_shared)
     fatal("failed to route");
   
+  if (routes_out)
+    {
+      routes_out->clear();
+      for (int i = 0; i < n_nets; ++i)
+        extend(*routes_out, net_net[i]->name(), net_route[i]);
+    }
+  
   int n_span4 = 0,
     n_span12 = 0;
   BitVector is_span4(chipdb->n_nets),
@@ -900,15 +1706,13 @@ Router::route()
 }
 
 void
-route(DesignState &ds, int max_passes)
+route(DesignState &ds, const RouteOptions &opts)
 {
-  Router router(ds, max_passes);
+  Router router(ds, opts);
   
-  clock_t start = clock();
+  auto start = std::chrono::steady_clock::now();
   router.route();
-  clock_t end = clock();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
   
-  *logs << "  route time "
-        << std::fixed << std::setprecision(2)
-        << (double)(end - start) / (double)CLOCKS_PER_SEC << "s\n";
+  *logs << "  route time " << Fixed(elapsed.count(), 2) << "s\n";
 }
@@ -25,7 +25,59 @@ class Design;
 class Instance;
 class ChipDB;
 class Configuration;
+class TimingGraph;
 
-extern void route(DesignState &ds, int max_passes);
+class RouteOptions
+{
+public:
+  int max_passes;
+  double astar_weight;
+  int bbox_margin;
+  int n_threads;
+  
+  // negotiated congestion: the cost of a cnet is
+  //   (base + hist_fac * history) * (1 + pres_fac * demand)
+  // where pres_fac is multiplied by pres_fac_mult after each pass, and
+  // doubled when the number of shared cnets hasn't improved for
+  // stall_passes passes (0 to disable).  In the last pass, a cnet
+  // already in use costs final_pass_penalty.
+  double pres_fac;
+  double pres_fac_mult;
+  double hist_fac;
+  int stall_passes;
+  int final_pass_penalty;
+  
+  // if not null, a net with criticality c has cnet cost
+  //   c * base + (1 - c) * congestion cost
+  // and the graph's wire delays are updated from the routes after
+  // each pass
+  TimingGraph *timing;
+  
+  // ECO routing: if not null, previous routes by net name.  The
+  // branches of a previous route that still reach the net's targets
+  // are kept and only rerouted if congested.
+  const std::map<std::string, std::vector<std::pair<int, int>>> *eco_routes;
+  
+  // if not null, set to the final routes by net name
+  std::map<std::string, std::vector<std::pair<int, int>>> *routes_out;
+  
+public:
+  RouteOptions()
+    : max_passes(200),
+      astar_weight(1.0),
+      bbox_margin(3),
+      n_threads(1),
+      pres_fac(3.0),
+      pres_fac_mult(1.0),
+      hist_fac(1.0),
+      stall_passes(0),
+      final_pass_penalty(1000000),
+      timing(nullptr),
+      eco_routes(nullptr),
+      routes_out(nullptr)
+  {}
+};
+
+extern void route(DesignState &ds, const RouteOptions &opts);
 
 #endif
@@ -0,0 +1,590 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "timing.hh"
+#include "util.hh"
+#include "casting.hh"
+#include "chipdb.hh"
+#include "designstate.hh"
+#include "line_parser.hh"
+
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <fstream>
+#include <algorithm>
+
+DelayModel::DelayModel()
+  : lut(450),
+    lut_carry(260),
+    carry(130),
+    dff_clk_q(540),
+    dff_setup(470),
+    io_in(1200),
+    io_out(2000),
+    ram_clk_q(2150),
+    ram_setup(250),
+    gb(600),
+    global_wire(300),
+    wire_base(300),
+    wire_per_tile(250),
+    wire_per_hop(230)
+{
+}
+
+class DelayModelParser : public LineParser
+{
+  const std::string &device;
+  DelayModel &dm;
+
+public:
+  DelayModelParser(const std::string &f, std::istream &s_,
+                   const std::string &device_, DelayModel &dm_)
+    : LineParser(f, s_),
+      device(device_),
+      dm(dm_)
+  {}
+  
+  void parse();
+};
+
+void
+DelayModelParser::parse()
+{
+  std::map<std::string, int *> keys = {
+    {"lut", &dm.lut},
+    {"lut_carry", &dm.lut_carry},
+    {"carry", &dm.carry},
+    {"dff_clk_q", &dm.dff_clk_q},
+    {"dff_setup", &dm.dff_setup},
+    {"io_in", &dm.io_in},
+    {"io_out", &dm.io_out},
+    {"ram_clk_q", &dm.ram_clk_q},
+    {"ram_setup", &dm.ram_setup},
+    {"gb", &dm.gb},
+    {"global_wire", &dm.global_wire},
+    {"wire_base", &dm.wire_base},
+    {"wire_per_tile", &dm.wire_per_tile},
+    {"wire_per_hop", &dm.wire_per_hop},
+  };
+  
+  bool active = true;
+  for (;;)
+    {
+      if (eof())
+        break;
+      
+      read_line();
+      if (words.empty())
+        continue;
+      
+      const std::string &key = words[0];
+      if (words.size() != 2)
+        fatal(fmt("`" << key << "': expected one argument"));
+      
+      if (key == "device")
+        {
+          active = (words[1] == device);
+          continue;
+        }
+      
+      auto i = keys.find(key);
+      if (i == keys.end())
+        fatal(fmt("unknown delay `" << key << "'"));
+      
+      const std::string &v = words[1];
+      char *end;
+      long d = strtol(v.c_str(), &end, 10);
+      if (v.empty()
+          || *end != '\0'
+          || d < 0
+          || d > INT_MAX)
+        fatal(fmt("invalid delay `" << v << "'"));
+      
+      if (active)
+        *i->second = (int)d;
+    }
+}
+
+DelayModel
+read_delay_model(const std::string &filename, const std::string &device)
+{
+  std::string expanded = expand_filename(filename);
+  std::ifstream fs(expanded);
+  if (fs.fail())
+    fatal(fmt("read_delay_model: failed to open `" << expanded << "': "
+              << strerror(errno)));
+  
+  DelayModel dm;
+  DelayModelParser parser(filename, fs, device, dm);
+  parser.parse();
+  return dm;
+}
+
+int
+TimingGraph::clock_of(Net *n)
+{
+  if (!n
+      || n->is_constant())
+    return -1;
+  
+  auto i = clock_idx.find(n);
+  if (i != clock_idx.end())
+    return i->second;
+  
+  int c = clocks.size();
+  clocks.push_back(n);
+  extend(clock_idx, n, c);
+  return c;
+}
+
+void
+TimingGraph::add_arc(Instance *inst, const std::string &in, const std::string &out, int delay)
+{
+  Port *p_in = inst->find_port(in),
+    *p_out = inst->find_port(out);
+  if (!p_in
+      || !p_out)
+    return;
+  
+  auto i = port_conn.find(p_in);
+  if (i == port_conn.end()
+      || !p_out->connected())
+    return;
+  auto j = net_idx.find(p_out->connection());
+  if (j == net_idx.end())
+    return;
+  
+  arc_conn.push_back(i->second);
+  arc_net.push_back(j->second);
+  arc_delay.push_back(delay);
+}
+
+void
+TimingGraph::add_start(Instance *inst, const std::string &out, int clock, int delay)
+{
+  Port *p = inst->find_port(out);
+  if (!p
+      || !p->connected())
+    return;
+  
+  auto i = net_idx.find(p->connection());
+  if (i != net_idx.end())
+    starts.push_back(std::make_tuple(i->second, clock, delay));
+}
+
+void
+TimingGraph::add_end(Instance *inst, const std::string &in, int clock, int setup)
+{
+  Port *p = inst->find_port(in);
+  if (!p)
+    return;
+  
+  auto i = port_conn.find(p);
+  if (i != port_conn.end())
+    ends.push_back(std::make_tuple(i->second, clock, setup));
+}
+
+TimingGraph::TimingGraph(const DesignState &ds,
+                         const DelayModel &dm_,
+                         double target_period_)
+  : chipdb(ds.chipdb),
+    dm(dm_),
+    target_period(target_period_)
+{
+  const Models &models = ds.models;
+  
+  for (Instance *inst : ds.top->instances())
+    {
+      extend(inst_idx, inst, (int)insts.size());
+      insts.push_back(inst);
+    }
+  
+  for (int i = 0; i < (int)insts.size(); ++i)
+    for (const auto &p : insts[i]->ports())
+      {
+        Port *port = p.second;
+        Net *n = port->connection();
+        if (n
+            && !n->is_constant()
+            && port->is_output()
+            && !contains_key(net_idx, n))
+          {
+            extend(net_idx, n, (int)nets.size());
+            nets.push_back(n);
+            net_driver.push_back(i);
+            net_global.push_back(port->name() == "GLOBAL_BUFFER_OUTPUT");
+          }
+      }
+  
+  // sinks, by net
+  int n_nets = nets.size();
+  std::vector<std::pair<int, Port *>> sinks;
+  for (int i = 0; i < (int)insts.size(); ++i)
+    for (const auto &p : insts[i]->ports())
+      {
+        Port *port = p.second;
+        if (!port->is_input()
+            || !port->connected())
+          continue;
+        auto j = net_idx.find(port->connection());
+        if (j != net_idx.end())
+          sinks.push_back(std::make_pair(j->second, port));
+      }
+  std::stable_sort(sinks.begin(), sinks.end(),
+                   [](const std::pair<int, Port *> &a,
+                      const std::pair<int, Port *> &b) { return a.first < b.first; });
+  
+  net_conn_begin.resize(n_nets + 1, 0);
+  for (const auto &p : sinks)
+    {
+      int k = conn_net.size();
+      ++net_conn_begin[p.first + 1];
+      conn_net.push_back(p.first);
+      conn_inst.push_back(inst_idx.at(cast<Instance>(p.second->node())));
+      conn_port.push_back(p.second);
+      extend(port_conn, p.second, k);
+    }
+  for (int i = 0; i < n_nets; ++i)
+    net_conn_begin[i + 1] += net_conn_begin[i];
+  int n_conns = conn_net.size();
+  conn_delay.resize(n_conns, dm.wire_base);
+  
+  for (Instance *inst : insts)
+    {
+      if (models.is_lc(inst))
+        {
+          bool dff = inst->get_param("DFF_ENABLE").get_bit(0),
+            carry = inst->get_param("CARRY_ENABLE").get_bit(0);
+          int clk = clock_of(inst->find_port("CLK")->connection());
+          
+          for (const char *in : {"I0", "I1", "I2", "I3"})
+            {
+              add_arc(inst, in, "LO", dm.lut);
+              if (dff)
+                add_end(inst, in, clk, dm.lut + dm.dff_setup);
+              else
+                add_arc(inst, in, "O", dm.lut);
+            }
+          if (carry)
+            {
+              add_arc(inst, "I1", "COUT", dm.lut_carry);
+              add_arc(inst, "I2", "COUT", dm.lut_carry);
+              add_arc(inst, "CIN", "COUT", dm.carry);
+            }
+          if (dff)
+            {
+              add_start(inst, "O", clk, dm.dff_clk_q);
+              add_end(inst, "CEN", clk, dm.dff_setup);
+              add_end(inst, "SR", clk, dm.dff_setup);
+            }
+        }
+      else if (models.is_ioX(inst))
+        {
+          add_start(inst, "D_IN_0", -1, dm.io_in);
+          add_start(inst, "D_IN_1", -1, dm.io_in);
+          add_start(inst, "GLOBAL_BUFFER_OUTPUT", -1, dm.io_in + dm.gb);
+          add_end(inst, "D_OUT_0", -1, dm.io_out);
+          add_end(inst, "D_OUT_1", -1, dm.io_out);
+          add_end(inst, "OUTPUT_ENABLE", -1, dm.io_out);
+        }
+      else if (models.is_gb(inst))
+        add_arc(inst, "USER_SIGNAL_TO_GLOBAL_BUFFER", "GLOBAL_BUFFER_OUTPUT", dm.gb);
+      else if (models.is_ramX(inst))
+        {
+          Port *rclk = inst->find_port("RCLK");
+          if (!rclk)
+            rclk = inst->find_port("RCLKN");
+          Port *wclk = inst->find_port("WCLK");
+          if (!wclk)
+            wclk = inst->find_port("WCLKN");
+          int rc = clock_of(rclk->connection()),
+            wc = clock_of(wclk->connection());
+          
+          for (const auto &p : inst->ports())
+            {
+              const std::string &name = p.first;
+              if (is_prefix("RDATA[", name))
+                add_start(inst, name, rc, dm.ram_clk_q);
+              else if (is_prefix("RADDR[", name)
+                       || name == "RE"
+                       || name == "RCLKE")
+                add_end(inst, name, rc, dm.ram_setup);
+              else if (is_prefix("WADDR[", name)
+                       || is_prefix("WDATA[", name)
+                       || is_prefix("MASK[", name)
+                       || name == "WE"
+                       || name == "WCLKE")
+                add_end(inst, name, wc, dm.ram_setup);
+            }
+        }
+    }
+  
+  // arcs by connection
+  std::vector<int> order(arc_conn.size());
+  for (int a = 0; a < (int)order.size(); ++a)
+    order[a] = a;
+  std::stable_sort(order.begin(), order.end(),
+                   [this](int a, int b) { return arc_conn[a] < arc_conn[b]; });
+  std::vector<int> sorted_conn, sorted_net, sorted_delay;
+  conn_arc_begin.assign(n_conns + 1, 0);
+  for (int a : order)
+    {
+      sorted_conn.push_back(arc_conn[a]);
+      sorted_net.push_back(arc_net[a]);
+      sorted_delay.push_back(arc_delay[a]);
+      ++conn_arc_begin[arc_conn[a] + 1];
+    }
+  for (int k = 0; k < n_conns; ++k)
+    conn_arc_begin[k + 1] += conn_arc_begin[k];
+  arc_conn = std::move(sorted_conn);
+  arc_net = std::move(sorted_net);
+  arc_delay = std::move(sorted_delay);
+  
+  // topological order of the nets, nets on combinational loops last
+  std::vector<int> indegree(n_nets, 0);
+  for (int m : arc_net)
+    ++indegree[m];
+  std::vector<bool> ordered(n_nets, false);
+  for (int i = 0; i < n_nets; ++i)
+    {
+      if (indegree[i] == 0)
+        {
+          topo_order.push_back(i);
+          ordered[i] = true;
+        }
+    }
+  for (int j = 0; j < (int)topo_order.size(); ++j)
+    {
+      int i = topo_order[j];
+      for (int k = net_conn_begin[i]; k < net_conn_begin[i + 1]; ++k)
+        for (int a = conn_arc_begin[k]; a < conn_arc_begin[k + 1]; ++a)
+          {
+            int m = arc_net[a];
+            if (--indegree[m] == 0)
+              {
+                topo_order.push_back(m);
+                ordered[m] = true;
+              }
+          }
+    }
+  int n_loop = n_nets - topo_order.size();
+  if (n_loop)
+    {
+      *logs << "  timing: " << n_loop << " nets on combinational loops\n";
+      for (int i = 0; i < n_nets; ++i)
+        {
+          if (!ordered[i])
+            topo_order.push_back(i);
+        }
+    }
+}
+
+std::vector<int>
+TimingGraph::placement_cells(const std::map<Instance *, int, IdLess> &placement) const
+{
+  std::vector<int> inst_cell(insts.size(), 0);
+  for (int i = 0; i < (int)insts.size(); ++i)
+    inst_cell[i] = lookup_or_default(placement, insts[i], 0);
+  return inst_cell;
+}
+
+void
+TimingGraph::estimate_wire_delays(const std::vector<int> &inst_cell)
+{
+  for (int i = 0; i < (int)nets.size(); ++i)
+    {
+      int c = inst_cell[net_driver[i]];
+      for (int k = net_conn_begin[i]; k < net_conn_begin[i + 1]; ++k)
+        {
+          int c2 = inst_cell[conn_inst[k]];
+          if (net_global[i])
+            conn_delay[k] = dm.global_wire;
+          else if (!c || !c2)
+            conn_delay[k] = dm.wire_base;
+          else
+            {
+              int t = chipdb->cell_location[c].tile(),
+                t2 = chipdb->cell_location[c2].tile();
+              if (t == t2
+                  && conn_port[k]->name() == "CIN")
+                conn_delay[k] = 0;  // carry chain within the tile
+              else
+                conn_delay[k] = (dm.wire_base
+                                 + dm.wire_per_tile * (std::abs(chipdb->tile_x(t) - chipdb->tile_x(t2))
+                                                       + std::abs(chipdb->tile_y(t) - chipdb->tile_y(t2))));
+            }
+        }
+    }
+}
+
+void
+TimingGraph::analyze()
+{
+  int n_nets = nets.size(),
+    n_conns = conn_net.size(),
+    n_clocks = clocks.size();
+  
+  domain_delay.assign(n_clocks + 1, -1);
+  conn_crit.assign(n_conns, 0.0);
+  net_crit.assign(n_nets, 0.0);
+  
+  // arrival times of paths from registers and from pads, -1 if none
+  std::vector<int> reg_arrival(n_nets),
+    pad_arrival(n_nets),
+    arrival(n_nets),
+    conn_required(n_conns);
+  
+  for (int d = 0; d <= n_clocks; ++d)
+    {
+      bool pad_to_pad = (d == n_clocks);
+      
+      std::fill(reg_arrival.begin(), reg_arrival.end(), -1);
+      std::fill(pad_arrival.begin(), pad_arrival.end(), -1);
+      for (const auto &s : starts)
+        {
+          int i, clk, delay;
+          std::tie(i, clk, delay) = s;
+          if (clk == -1)
+            pad_arrival[i] = std::max(pad_arrival[i], delay);
+          else if (clk == d)
+            reg_arrival[i] = std::max(reg_arrival[i], delay);
+        }
+      
+      for (int i : topo_order)
+        for (int k = net_conn_begin[i]; k < net_conn_begin[i + 1]; ++k)
+          for (int a = conn_arc_begin[k]; a < conn_arc_begin[k + 1]; ++a)
+            {
+              int m = arc_net[a],
+                delay = conn_delay[k] + arc_delay[a];
+              if (reg_arrival[i] >= 0)
+                reg_arrival[m] = std::max(reg_arrival[m], reg_arrival[i] + delay);
+              if (pad_arrival[i] >= 0)
+                pad_arrival[m] = std::max(pad_arrival[m], pad_arrival[i] + delay);
+            }
+      
+      for (int i = 0; i < n_nets; ++i)
+        arrival[i] = (pad_to_pad
+                      ? pad_arrival[i]
+                      : std::max(reg_arrival[i], pad_arrival[i]));
+      
+      int crit_delay = -1;
+      for (const auto &e : ends)
+        {
+          int k, clk, setup;
+          std::tie(k, clk, setup) = e;
+          int i = conn_net[k];
+          int t;
+          if (clk == -1)
+            t = pad_to_pad ? pad_arrival[i] : reg_arrival[i];
+          else if (clk == d)
+            t = arrival[i];
+          else
+            continue;
+          if (t >= 0)
+            crit_delay = std::max(crit_delay, t + conn_delay[k] + setup);
+        }
+      domain_delay[d] = crit_delay;
+      if (crit_delay <= 0)
+        continue;
+      
+      double period = (target_period > 0.0
+                       ? target_period
+                       : (double)crit_delay);
+      int required = (int)period;
+      
+      // Required times at the sink ports, backwards, from the register
+      // ends of d or from the pad ends, and the criticality of the
+      // connections on paths to them from the starts in from.  Paths
+      // to pads only start at pads in the pad-to-pad domain.
+      auto add_crit = [&](bool pad_ends, const std::vector<int> &from) {
+        std::fill(conn_required.begin(), conn_required.end(), INT_MAX);
+        for (const auto &e : ends)
+          {
+            int k, clk, setup;
+            std::tie(k, clk, setup) = e;
+            if (clk == (pad_ends ? -1 : d))
+              conn_required[k] = std::min(conn_required[k], required - setup);
+          }
+        std::vector<int> net_required(n_nets, INT_MAX);
+        for (int j = n_nets - 1; j >= 0; --j)
+          {
+            int i = topo_order[j];
+            int r = INT_MAX;
+            for (int k = net_conn_begin[i]; k < net_conn_begin[i + 1]; ++k)
+              {
+                int rk = conn_required[k];
+                for (int a = conn_arc_begin[k]; a < conn_arc_begin[k + 1]; ++a)
+                  {
+                    int m = arc_net[a];
+                    if (net_required[m] != INT_MAX)
+                      rk = std::min(rk, net_required[m] - arc_delay[a]);
+                  }
+                conn_required[k] = rk;
+                if (rk != INT_MAX)
+                  r = std::min(r, rk - conn_delay[k]);
+              }
+            net_required[i] = r;
+          }
+        
+        for (int i = 0; i < n_nets; ++i)
+          {
+            if (from[i] < 0)
+              continue;
+            for (int k = net_conn_begin[i]; k < net_conn_begin[i + 1]; ++k)
+              {
+                if (conn_required[k] == INT_MAX)
+                  continue;
+                int slack = conn_required[k] - (from[i] + conn_delay[k]);
+                double crit = 1.0 - slack / period;
+                crit = std::min(1.0, std::max(0.0, crit));
+                conn_crit[k] = std::max(conn_crit[k], crit);
+                net_crit[i] = std::max(net_crit[i], crit);
+              }
+          }
+      };
+      
+      if (pad_to_pad)
+        add_crit(true, pad_arrival);
+      else
+        {
+          add_crit(false, arrival);
+          add_crit(true, reg_arrival);
+        }
+    }
+}
+
+void
+TimingGraph::report(std::ostream &s) const
+{
+  int n_clocks = clocks.size();
+  for (int d = 0; d <= n_clocks; ++d)
+    {
+      int delay = domain_delay[d];
+      if (delay < 0)
+        continue;
+      
+      if (d < n_clocks)
+        s << "  clock " << clocks[d]->name() << ": ";
+      else
+        s << "  pad to pad: ";
+      s << "critical path " << Fixed(delay / 1000.0, 2) << " ns";
+      if (d < n_clocks)
+        s << ", Fmax " << Fixed(1e6 / delay, 2) << " MHz";
+      if (target_period > 0.0)
+        s << ", worst slack " << Fixed((target_period - delay) / 1000.0, 2) << " ns";
+      s << "\n";
+    }
+}
@@ -0,0 +1,130 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef PNR_TIMING_HH
+#define PNR_TIMING_HH
+
+#include "netlist.hh"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+
+class ChipDB;
+class DesignState;
+
+// Delays in ps.
+class DelayModel
+{
+public:
+  int lut;           // LUT input to O or LO
+  int lut_carry;     // I1, I2 to COUT
+  int carry;         // CIN to COUT
+  int dff_clk_q;
+  int dff_setup;
+  int io_in;         // pad to D_IN
+  int io_out;        // D_OUT, OUTPUT_ENABLE to pad
+  int ram_clk_q;
+  int ram_setup;
+  int gb;            // global buffer
+  int global_wire;   // global network to a sink
+  int wire_base;     // any routed connection
+  int wire_per_tile; // per tile of distance, before routing
+  int wire_per_hop;  // per routing resource, after routing
+
+public:
+  DelayModel();
+};
+
+// Reads `<name> <ps>' lines, `#' comments.  `device <device>' starts a
+// section that applies only to <device>.
+extern DelayModel read_delay_model(const std::string &filename,
+                                   const std::string &device);
+
+// Static timing over the packed netlist.  Timing nodes are the nets
+// driven by instance outputs; a connection is a net's sink port.
+// Register outputs and input pads start paths, register inputs and
+// output pads end them.  Each clock net is a domain, and paths to or
+// from pads are timed in the domain of the register at the other end.
+class TimingGraph
+{
+public:
+  const ChipDB *chipdb;
+  DelayModel dm;
+  
+  // required period in ps, 0 to use each domain's critical delay
+  double target_period;
+  
+  std::vector<Instance *> insts;
+  std::map<Instance *, int, IdLess> inst_idx;
+  
+  std::vector<Net *> nets;
+  std::map<Net *, int, IdLess> net_idx;
+  std::vector<int> net_driver;
+  std::vector<bool> net_global;
+  
+  // the connections of net i are net_conn_begin[i] up to
+  // net_conn_begin[i+1]
+  std::vector<int> net_conn_begin;
+  std::vector<int> conn_net;
+  std::vector<int> conn_inst;
+  std::vector<Port *> conn_port;
+  std::map<Port *, int, IdLess> port_conn;
+  
+  // wire delay of each connection, set by estimate_wire_delays or the
+  // router
+  std::vector<int> conn_delay;
+  
+  // combinational arcs from connection arc_conn[a] to net
+  // arc_net[a]; the arcs from connection k are conn_arc_begin[k] up
+  // to conn_arc_begin[k+1]
+  std::vector<int> conn_arc_begin;
+  std::vector<int> arc_conn;
+  std::vector<int> arc_net;
+  std::vector<int> arc_delay;
+  
+  std::vector<Net *> clocks;
+  std::map<Net *, int, IdLess> clock_idx;
+  
+  // (net, clock or -1 for pads, delay)
+  std::vector<std::tuple<int, int, int>> starts;
+  // (connection, clock or -1 for pads, setup)
+  std::vector<std::tuple<int, int, int>> ends;
+  
+  std::vector<int> topo_order;
+  
+  // results of analyze: critical delay by clock, then pad to pad, -1
+  // if there are no paths
+  std::vector<int> domain_delay;
+  std::vector<double> conn_crit;
+  std::vector<double> net_crit;
+  
+  int clock_of(Net *n);
+  void add_arc(Instance *inst, const std::string &in, const std::string &out, int delay);
+  void add_start(Instance *inst, const std::string &out, int clock, int delay);
+  void add_end(Instance *inst, const std::string &in, int clock, int setup);
+
+public:
+  TimingGraph(const DesignState &ds, const DelayModel &dm_, double target_period_);
+  
+  std::vector<int> placement_cells(const std::map<Instance *, int, IdLess> &placement) const;
+  void estimate_wire_delays(const std::vector<int> &inst_cell);
+  void analyze();
+  void report(std::ostream &s) const;
+};
+
+#endif
@@ -149,6 +149,28 @@ operator<<(std::ostream &s, const std::unordered_map<K, V> &M)
   return s << "}";
 }
 
+// Writes x in fixed notation with the given precision, leaving the
+// stream's format flags and precision unchanged.
+struct Fixed
+{
+  double x;
+  int precision;
+  Fixed(double x_, int precision_) : x(x_), precision(precision_) {}
+};
+
+inline std::ostream &
+operator<<(std::ostream &s, const Fixed &f)
+{
+  std::ios_base::fmtflags flags = s.flags();
+  std::streamsize precision = s.precision();
+  s.setf(std::ios_base::fixed, std::ios_base::floatfield);
+  s.precision(f.precision);
+  s << f.x;
+  s.flags(flags);
+  s.precision(precision);
+  return s;
+}
+
 #define fmt(x) (static_cast<const std::ostringstream&>(std::ostringstream() << x).str())
 
 extern void fatal(const std::string &msg);
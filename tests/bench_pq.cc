@@ -0,0 +1,84 @@
+
+#include "util.hh"
+#include "priorityq.hh"
+#include "radixq.hh"
+#include "indexedq.hh"
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <ctime>
+
+class Comp
+{
+public:
+  Comp() {}
+  
+  bool operator()(const std::pair<int, int> &lhs,
+                  const std::pair<int, int> &rhs) const
+  {
+    return (lhs.second > rhs.second
+            || (lhs.second == rhs.second
+                && lhs.first > rhs.first));
+  }
+};
+
+// Dijkstra workload: each pop settles a value and lowers the keys of
+// a few others to slightly more than its own, skipping stale entries.
+// Keys only decrease, so all queues pop the same sequence.
+template<typename Q> long
+bench(const char *name, int n_values, int n_ops)
+{
+  random_generator rg;
+  std::vector<int> key(n_values);
+  Q q;
+  
+  clock_t start = clock();
+  long sum = 0;
+  for (int r = 0; r < 10; ++r)
+    {
+      std::fill(key.begin(), key.end(), INT_MAX);
+      q.clear();
+      key[0] = 0;
+      q.push(std::make_pair(0, 0));
+      for (int k = 0; k < n_ops && !q.empty();)
+        {
+          std::pair<int, int> x = q.pop();
+          if (x.second != key[x.first])
+            continue;
+          ++k;
+          sum += x.second;
+          for (int j = 0; j < 4; ++j)
+            {
+              int v = rg.random_int(0, n_values - 1),
+                new_key = x.second + rg.random_int(1, 20);
+              if (new_key < key[v])
+                {
+                  key[v] = new_key;
+                  q.push(std::make_pair(v, new_key));
+                }
+            }
+        }
+    }
+  clock_t end = clock();
+  
+  std::cout << name << ": "
+            << (double)(end - start) / (double)CLOCKS_PER_SEC << "s"
+            << " (" << sum << ")\n";
+  return sum;
+}
+
+int
+main()
+{
+  int n_values = 100000,
+    n_ops = 1000000;
+  long sum = bench<PriorityQ<std::pair<int, int>, Comp>>("binary heap", n_values, n_ops);
+  if (bench<RadixQ>("radix heap", n_values, n_ops) != sum
+      || bench<IndexedQ>("indexed heap", n_values, n_ops) != sum)
+    {
+      std::cout << "queues popped different sequences\n";
+      return 1;
+    }
+}
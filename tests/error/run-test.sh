@@ -21,3 +21,9 @@ if [ x"$?" != x"1" ]; then
     echo "error, stopping."
     exit 1
 fi
+
+$arachne_pnr --delay-model bad.delays dup_pin.blif -o /dev/null
+if [ x"$?" != x"1" ]; then
+    echo "error, stopping."
+    exit 1
+fi
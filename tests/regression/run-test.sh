@@ -29,6 +29,18 @@ for d in 1k 8k; do
     
     $arachne_pnr -d $d c3demo.blif -o $d/c3demo.txt
     icepack $d/c3demo.txt $d/c3demo.bin
+    
+    # ECO round trip: place and route again from the written placement
+    # and routes
+    $arachne_pnr -d $d test2.blif --write-placement $d/test2.place --write-routes $d/test2.routes -o $d/test2_eco0.txt
+    $arachne_pnr -d $d test2.blif --place-eco $d/test2.place --route-eco $d/test2.routes -o $d/test2_eco1.txt
+    icepack $d/test2_eco1.txt $d/test2_eco1.bin
+    $arachne_pnr -d $d test2.blif --place-eco $d/test2.place --place-eco-lock --route-eco $d/test2.routes --write-placement $d/test2_eco2.place -o $d/test2_eco2.txt
+    icepack $d/test2_eco2.txt $d/test2_eco2.bin
+    cmp $d/test2.place $d/test2_eco2.place
+    
+    $arachne_pnr -d $d --delay-model test.delays c3demo.blif -o $d/c3demo_timing.txt
+    icepack $d/c3demo_timing.txt $d/c3demo_timing.bin
 done
 
 $arachne_pnr -d 8k -p pin_type_fail.pcf pin_type_fail.blif
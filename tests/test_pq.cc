@@ -0,0 +1,142 @@
+
+#include "radixq.hh"
+#include "indexedq.hh"
+#include "util.hh"
+
+#include <set>
+#include <map>
+#include <iostream>
+#include <cassert>
+
+void
+test_radixq(int n, random_generator &rg)
+{
+  std::multiset<int> a;
+  RadixQ b;
+  
+  // monotone: pops come out in key order
+  int last = 0;
+  for (int k = 0; k < 3*n; ++k)
+    {
+      if (b.empty()
+          || random_int(0, 2, rg) > 0)
+        {
+          int key = last + random_int(0, 100, rg);
+          a.insert(key);
+          b.push(std::make_pair(k, key));
+        }
+      else
+        {
+          assert(b.top().second == *a.begin());
+          std::pair<int, int> x = b.pop();
+          assert(x.second == *a.begin());
+          a.erase(a.begin());
+          last = x.second;
+        }
+      assert(a.size() == b.size());
+    }
+  while (!b.empty())
+    {
+      std::pair<int, int> x = b.pop();
+      assert(x.second == *a.begin());
+      a.erase(a.begin());
+    }
+  assert(a.empty());
+  
+  // keys below the last pop come out next, in key order
+  b.clear();
+  b.push(std::make_pair(0, 10));
+  b.push(std::make_pair(1, 20));
+  assert(b.pop().second == 10);
+  b.push(std::make_pair(2, 8));
+  b.push(std::make_pair(3, 6));
+  b.push(std::make_pair(4, 4));
+  b.push(std::make_pair(5, 15));
+  b.push(std::make_pair(6, 6));
+  assert(b.pop() == std::make_pair(4, 4));
+  assert(b.pop() == std::make_pair(3, 6));
+  assert(b.pop() == std::make_pair(6, 6));
+  assert(b.pop() == std::make_pair(2, 8));
+  assert(b.pop().second == 15);
+  assert(b.pop().second == 20);
+  assert(b.empty());
+  
+  // random keys below the last pop, with and without restart
+  for (int r = 0; r < 2; ++r)
+    {
+      a.clear();
+      b.clear();
+      last = 0;
+      for (int k = 0; k < 3*n; ++k)
+        {
+          if (b.empty()
+              || random_int(0, 2, rg) > 0)
+            {
+              int key = std::max(0, last + random_int(-50, 100, rg));
+              a.insert(key);
+              b.push(std::make_pair(k, key));
+            }
+          else
+            {
+              if (r == 1
+                  && random_int(0, 9, rg) == 0)
+                b.restart();
+              std::pair<int, int> x = b.pop();
+              assert(x.second == *a.begin());
+              a.erase(a.begin());
+              last = x.second;
+            }
+          assert(a.size() == b.size());
+        }
+    }
+}
+
+void
+test_indexedq(int n, random_generator &rg)
+{
+  std::map<int, int> a;
+  IndexedQ b;
+  
+  for (int k = 0; k < 3*n; ++k)
+    {
+      if (b.empty()
+          || random_int(0, 2, rg) > 0)
+        {
+          int i = random_int(0, n, rg),
+            key = random_int(0, 1000, rg);
+          a[i] = key;
+          b.push(std::make_pair(i, key));
+        }
+      else
+        {
+          std::pair<int, int> x = b.pop();
+          for (const auto &p : a)
+            assert(x.second < p.second
+                   || (x.second == p.second
+                       && x.first <= p.first));
+          assert(a.at(x.first) == x.second);
+          a.erase(x.first);
+        }
+      assert(a.size() == b.size());
+      for (int i = 0; i <= n; ++i)
+        assert(contains_key(a, i) == b.contains(i));
+    }
+  
+  b.clear();
+  assert(b.empty());
+  for (int i = 0; i <= n; ++i)
+    assert(!b.contains(i));
+}
+
+int
+main()
+{
+  random_generator rg;
+  
+  for (int n = 0; n <= 200; ++n)
+    {
+      test_radixq(n, rg);
+      test_indexedq(n, rg);
+    }
+  test_radixq(10000, rg);
+}